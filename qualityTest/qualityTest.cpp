@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <randomSequenceGenerator.hpp>
+
+#include "statisticalTests.hpp"
+
+struct SOptions
+{
+    std::string _backend = "auto";
+    size_t _bytes = 1ULL << 30;
+    size_t _bufferSize = 64ULL << 20;
+    size_t _threads = std::max(1U, std::thread::hardware_concurrency());
+    double _significance = 1e-6;
+};
+
+static size_t ParseSize(const std::string& value)
+{
+    size_t pos = 0;
+    size_t size = std::stoull(value, &pos);
+    if (pos < value.size())
+    {
+        switch (value[pos])
+        {
+        case 'K': case 'k': size <<= 10; break;
+        case 'M': case 'm': size <<= 20; break;
+        case 'G': case 'g': size <<= 30; break;
+        default: throw std::invalid_argument("Unknown size suffix in " + value);
+        }
+    }
+    return size;
+}
+
+static void PrintUsage()
+{
+    std::cout << "Usage: qualityTest [--backend cpu|gpu|auto|chacha8|chacha12|chacha20|shared:<name>] [--bytes <size>[K|M|G]] [--buffer <size>[K|M|G]] [--threads <n>] [--significance <p>]" << std::endl;
+}
+
+static bool ParseOptions(int argc, char* argv[], SOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc)
+            return false;
+
+        const std::string value = argv[++i];
+        if (arg == "--backend")
+            options._backend = value;
+        else if (arg == "--bytes")
+            options._bytes = ParseSize(value);
+        else if (arg == "--buffer")
+            options._bufferSize = ParseSize(value);
+        else if (arg == "--threads")
+            options._threads = std::max<size_t>(1, std::stoull(value));
+        else if (arg == "--significance")
+            options._significance = std::stod(value);
+        else
+            return false;
+    }
+
+    return true;
+}
+
+static std::unique_ptr<CRandomSequenceGenerator> MakeGenerator(const SOptions& options)
+{
+    auto decreaseThreadPriority = []() {};
+    const std::string sharedPrefix = "shared:";
+
+    if (options._backend == "cpu")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+    else if (options._backend == "gpu")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::GPU_GENERATOR);
+    else if (options._backend == "auto")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::GPU_IF_POSSIBLE_GENERATOR);
+    else if (options._backend == "chacha8")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CHACHA8_GENERATOR);
+    else if (options._backend == "chacha12")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CHACHA12_GENERATOR);
+    else if (options._backend == "chacha20")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CHACHA20_GENERATOR);
+    else if (options._backend.starts_with(sharedPrefix))
+        return CRandomSequenceGenerator::MakeSharedClient(options._backend.substr(sharedPrefix.size()), options._bufferSize, decreaseThreadPriority);
+    else
+        throw std::invalid_argument("Unknown backend " + options._backend);
+}
+
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    try
+    {
+        auto gen = MakeGenerator(options);
+        while (!gen->ReadyToWork())
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+
+        // Spans are valid until the ring wraps around, so every chunk is copied out under the lock
+        // and the tests themselves run in parallel
+        const size_t chunkSize = std::clamp<size_t>(gen->BufferSize() / 2, 1, 4ULL << 20);
+        std::mutex generatorMutex;
+        size_t bytesRequested = 0;
+
+        std::vector<CStatisticalAccumulator> accumulators(options._threads);
+        std::vector<std::thread> workers;
+
+        const auto startTimePoint = std::chrono::steady_clock::now();
+        for (CStatisticalAccumulator& accumulator : accumulators)
+        {
+            workers.emplace_back([&]()
+            {
+                std::vector<uint8_t> chunk(chunkSize);
+                while (true)
+                {
+                    {
+                        std::lock_guard lock(generatorMutex);
+                        if (bytesRequested >= options._bytes)
+                            break;
+
+                        chunk.resize(std::min(chunkSize, options._bytes - bytesRequested));
+                        std::span<uint8_t> bytes = gen->GetDataSpan<uint8_t>(chunk.size());
+                        std::memcpy(chunk.data(), bytes.data(), bytes.size());
+                        bytesRequested += chunk.size();
+                    }
+
+                    accumulator.Process(chunk);
+                }
+            });
+        }
+
+        for (std::thread& worker : workers)
+            worker.join();
+        const auto endTimePoint = std::chrono::steady_clock::now();
+
+        for (size_t i = 1; i < accumulators.size(); ++i)
+            accumulators[0].Merge(accumulators[i]);
+
+        const double seconds = std::chrono::duration<double>(endTimePoint - startTimePoint).count();
+        std::cout << "* " << accumulators[0].BytesProcessed() << " bytes from " << options._backend << " backend in " << seconds << " s ("
+            << static_cast<size_t>(accumulators[0].BytesProcessed() / seconds / 1'000'000) << " MB/s, " << options._threads << " threads)" << std::endl;
+
+        bool allPassed = true;
+        for (const STestResult& result : accumulators[0].Results(options._significance))
+        {
+            std::cout << "- " << std::left << std::setw(28) << result._name << " statistic = " << std::setw(14) << result._statistic
+                << " p = " << std::setw(12) << result._pValue << (result._passed ? "PASS" : "FAIL") << std::endl;
+            allPassed &= result._passed;
+        }
+
+        return allPassed ? 0 : 1;
+    }
+    catch (const std::exception& err)
+    {
+        std::cout << "*** " << err.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "statisticalTests.hpp"
+
+static double NormalPValue(double z)
+{
+    // Two-sided, too good fit is as suspicious as a bad one
+    return std::erfc(std::abs(z) / std::sqrt(2.0));
+}
+
+static double ChiSquareZ(double chiSquare, double degreesOfFreedom)
+{
+    // Wilson-Hilferty transformation
+    const double variance = 2.0 / (9.0 * degreesOfFreedom);
+    return (std::cbrt(chiSquare / degreesOfFreedom) - (1.0 - variance)) / std::sqrt(variance);
+}
+
+template<typename TCounters>
+static double ChiSquare(const TCounters& counters)
+{
+    uint64_t total = 0;
+    for (uint64_t counter : counters)
+        total += counter;
+
+    const double expected = static_cast<double>(total) / counters.size();
+    double chiSquare = 0;
+    for (uint64_t counter : counters)
+    {
+        const double diff = counter - expected;
+        chiSquare += diff * diff / expected;
+    }
+
+    return chiSquare;
+}
+
+void CStatisticalAccumulator::Process(std::span<const uint8_t> chunk)
+{
+    _bytesProcessed += chunk.size();
+
+    for (uint8_t byte : chunk)
+        ++_bytes[byte];
+
+    for (size_t i = 1; i < chunk.size(); i += 2)
+        ++_words[chunk[i - 1] | (chunk[i] << 8)];
+
+    for (size_t i = 0; i < chunk.size(); ++i)
+    {
+        const uint64_t value = chunk[i];
+        _serialSum += value;
+        _serialSumSquares += value * value;
+        if (i)
+            _serialSumProducts += value * chunk[i - 1];
+    }
+    _serialValues += chunk.size();
+    _serialPairs += chunk.empty() ? 0 : chunk.size() - 1;
+
+    // Runs are counted as transitions between adjacent bits, least significant bit first
+    uint64_t prevWord = 0;
+    const size_t words = chunk.size() / sizeof(uint64_t);
+    for (size_t i = 0; i < words; ++i)
+    {
+        uint64_t word;
+        std::memcpy(&word, chunk.data() + i * sizeof(uint64_t), sizeof(word));
+        _bitTransitions += std::popcount((word ^ (word >> 1)) & 0x7fffffffffffffffULL);
+        if (i)
+            _bitTransitions += (prevWord >> 63) ^ (word & 1);
+        prevWord = word;
+    }
+    _bitPairs += words ? words * 64 - 1 : 0;
+
+    ProcessBirthdaySpacings(chunk);
+
+    for (size_t offset = 0; offset + _blockSize <= chunk.size(); offset += _blockSize)
+        _blockHashes.push_back(BlockHash(chunk.data() + offset));
+}
+
+void CStatisticalAccumulator::ProcessBirthdaySpacings(std::span<const uint8_t> chunk)
+{
+    constexpr size_t sampleBytes = _birthdays * sizeof(uint32_t);
+    constexpr uint32_t daysMask = (1U << _birthdayDaysBits) - 1;
+
+    std::array<uint32_t, _birthdays> birthdays;
+    for (size_t offset = 0; offset + sampleBytes <= chunk.size(); offset += sampleBytes)
+    {
+        std::memcpy(birthdays.data(), chunk.data() + offset, sampleBytes);
+        for (uint32_t& birthday : birthdays)
+            birthday &= daysMask;
+
+        // Spacings are taken around the circle so all of them are identically distributed
+        std::sort(birthdays.begin(), birthdays.end());
+        const uint32_t wrapSpacing = (1U << _birthdayDaysBits) - birthdays.back() + birthdays.front();
+        for (size_t i = birthdays.size() - 1; i > 0; --i)
+            birthdays[i] -= birthdays[i - 1];
+        birthdays[0] = wrapSpacing;
+        std::sort(birthdays.begin(), birthdays.end());
+
+        for (size_t i = 1; i < birthdays.size(); ++i)
+            if (birthdays[i] == birthdays[i - 1])
+                ++_birthdayDuplicates;
+
+        ++_birthdaySamples;
+    }
+}
+
+/* static */ uint64_t CStatisticalAccumulator::BlockHash(const uint8_t* block) noexcept
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < _blockSize; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, block + i, sizeof(word));
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+void CStatisticalAccumulator::Merge(const CStatisticalAccumulator& other)
+{
+    _bytesProcessed += other._bytesProcessed;
+
+    for (size_t i = 0; i < _bytes.size(); ++i)
+        _bytes[i] += other._bytes[i];
+    for (size_t i = 0; i < _words.size(); ++i)
+        _words[i] += other._words[i];
+
+    _serialValues += other._serialValues;
+    _serialSum += other._serialSum;
+    _serialSumSquares += other._serialSumSquares;
+    _serialPairs += other._serialPairs;
+    _serialSumProducts += other._serialSumProducts;
+
+    _bitPairs += other._bitPairs;
+    _bitTransitions += other._bitTransitions;
+
+    _birthdaySamples += other._birthdaySamples;
+    _birthdayDuplicates += other._birthdayDuplicates;
+
+    _blockHashes.insert(_blockHashes.end(), other._blockHashes.begin(), other._blockHashes.end());
+}
+
+std::vector<STestResult> CStatisticalAccumulator::Results(double significance)
+{
+    std::vector<STestResult> results;
+
+    auto addResult = [&results, significance](std::string name, double statistic, double pValue)
+    {
+        results.push_back({ std::move(name), statistic, pValue, pValue >= significance });
+    };
+
+    {
+        const double chiSquare = ChiSquare(_bytes);
+        addResult("Chi-square on bytes", chiSquare, NormalPValue(ChiSquareZ(chiSquare, _bytes.size() - 1)));
+    }
+
+    {
+        const double chiSquare = ChiSquare(_words);
+        addResult("Chi-square on 16-bit words", chiSquare, NormalPValue(ChiSquareZ(chiSquare, _words.size() - 1)));
+    }
+
+    {
+        const double n = static_cast<double>(_serialValues);
+        const double mean = _serialSum / n;
+        const double variance = _serialSumSquares / n - mean * mean;
+        const double covariance = _serialSumProducts / static_cast<double>(_serialPairs) - mean * mean;
+        const double correlation = covariance / variance;
+        addResult("Serial correlation", correlation, NormalPValue(correlation * std::sqrt(static_cast<double>(_serialPairs))));
+    }
+
+    {
+        const double pairs = static_cast<double>(_bitPairs);
+        const double z = (_bitTransitions - pairs / 2) / std::sqrt(pairs / 4);
+        addResult("Runs", static_cast<double>(_bitTransitions + 1), NormalPValue(z));
+    }
+
+    {
+        const double expected = _birthdaySamples * _birthdayLambda;
+        const double z = (_birthdayDuplicates - expected) / std::sqrt(expected);
+        addResult("Birthday spacings", static_cast<double>(_birthdayDuplicates), NormalPValue(z));
+    }
+
+    {
+        std::sort(_blockHashes.begin(), _blockHashes.end());
+        size_t duplicates = 0;
+        for (size_t i = 1; i < _blockHashes.size(); ++i)
+            if (_blockHashes[i] == _blockHashes[i - 1])
+                ++duplicates;
+
+        // Collision probability of distinct blocks is negligible, any duplicate is a failure
+        addResult("Duplicate blocks", static_cast<double>(duplicates), duplicates ? 0.0 : 1.0);
+    }
+
+    return results;
+}
@@ -0,0 +1,66 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_STATISTICAL_TESTS_
+#define RANDOM_SEQUENCE_GENERATOR_STATISTICAL_TESTS_
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+struct STestResult
+{
+    std::string _name;
+    double _statistic;
+    double _pValue;
+    bool _passed;
+};
+
+// Streaming accumulator for the statistical tests. Every worker thread processes its own chunks,
+// accumulators are merged afterwards so the results don't depend on the chunks distribution
+class CStatisticalAccumulator
+{
+public:
+    static constexpr size_t _blockSize = 4096;
+
+    void Process(std::span<const uint8_t> chunk);
+    void Merge(const CStatisticalAccumulator& other);
+    std::vector<STestResult> Results(double significance);
+
+    uint64_t BytesProcessed() const noexcept { return _bytesProcessed; }
+
+private:
+    static constexpr size_t _birthdays = 512;
+    static constexpr uint32_t _birthdayDaysBits = 24;
+
+    // Expected duplicated spacings per sample : m(m-1)^2/4n pairs of equal spacings on the circle
+    // minus m(m-1)^2(m-2)^2/18n^2 for triples which are counted twice instead of three times
+    static constexpr double _birthdayLambda = []()
+    {
+        constexpr double m = _birthdays;
+        constexpr double n = 1 << _birthdayDaysBits;
+        return m * (m - 1) * (m - 1) / (4 * n) - m * (m - 1) * (m - 1) * (m - 2) * (m - 2) / (18 * n * n);
+    }();
+
+    uint64_t _bytesProcessed = 0;
+    std::array<uint64_t, 256> _bytes{};
+    std::vector<uint64_t> _words = std::vector<uint64_t>(65536);
+
+    uint64_t _serialValues = 0;
+    uint64_t _serialSum = 0;
+    uint64_t _serialSumSquares = 0;
+    uint64_t _serialPairs = 0;
+    uint64_t _serialSumProducts = 0;
+
+    uint64_t _bitPairs = 0;
+    uint64_t _bitTransitions = 0;
+
+    uint64_t _birthdaySamples = 0;
+    uint64_t _birthdayDuplicates = 0;
+
+    std::vector<uint64_t> _blockHashes;
+
+    void ProcessBirthdaySpacings(std::span<const uint8_t> chunk);
+    static uint64_t BlockHash(const uint8_t* block) noexcept;
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_STATISTICAL_TESTS_
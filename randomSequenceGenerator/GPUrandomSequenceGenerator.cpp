@@ -1,31 +1,72 @@
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <limits>
 
 #include "include/randomSequenceGenerator.hpp"
 #include "GPUrandomSequenceGenerator.hpp"
 
 /* static */ const std::string CGPURandomSequenceGenerator::_clProgram = R"(
-uchar LCG1(global uint* state)
-{
-    *state = (*state * 214013U + 2531011U) & 0xffffffff;
-    return (*state >> 16) & 0xff;
-}
-
-uchar LCG2(global uint* state)
-{
-    *state = (*state * 1103515245 + 12345) & 0xffffffff;
-    return (*state >> 16) & 0xff;
+#define LCG1(state) ((state) * 214013U + 2531011U)
+#define LCG2(state) ((state) * 1103515245U + 12345U)
+
+#define UINT_1 uint
+#define UINT_2 uint2
+#define UINT_4 uint4
+#define UINT_8 uint8
+#define LOAD_1(pointer) (*(pointer))
+#define LOAD_2(pointer) vload2(0, pointer)
+#define LOAD_4(pointer) vload4(0, pointer)
+#define LOAD_8(pointer) vload8(0, pointer)
+#define STORE_1(value, pointer) (*(pointer) = (value))
+#define STORE_2(value, pointer) vstore2(value, 0, pointer)
+#define STORE_4(value, pointer) vstore4(value, 0, pointer)
+#define STORE_8(value, pointer) vstore8(value, 0, pointer)
+#define TO_UCHAR_1 convert_uchar
+#define TO_UCHAR_2 convert_uchar2
+#define TO_UCHAR_4 convert_uchar4
+#define TO_UCHAR_8 convert_uchar8
+
+// Every byte has its own pair of the LCG states stepped once per fill, the variants produce the same bytes
+// and differ by the bytes amount per work item and the vector width only
+#define GENERATE_RANDOM_NUMBER(width)                                                                       \
+kernel void GenerateRandomNumber##width(                                                                    \
+    global uint* lcg1State,                                                                                 \
+    global uint* lcg2State,                                                                                 \
+    global uchar* result,                                                                                   \
+    ulong size,                                                                                             \
+    uint itemsPerWorkItem                                                                                   \
+)                                                                                                           \
+{                                                                                                           \
+    for (uint item = 0; item < itemsPerWorkItem; ++item)                                                    \
+    {                                                                                                       \
+        const ulong first = (get_global_id(0) * itemsPerWorkItem + item) * width;                          \
+        if (first + width <= size)                                                                          \
+        {                                                                                                   \
+            const UINT_##width state1 = LCG1(LOAD_##width(lcg1State + first));                              \
+            const UINT_##width state2 = LCG2(LOAD_##width(lcg2State + first));                              \
+            STORE_##width(state1, lcg1State + first);                                                       \
+            STORE_##width(state2, lcg2State + first);                                                       \
+            STORE_##width(TO_UCHAR_##width(((state1 ^ state2) >> 16) & 0xff), result + first);              \
+        }                                                                                                   \
+        else                                                                                                \
+        {                                                                                                   \
+            for (ulong n = first; n < size; ++n)                                                            \
+            {                                                                                               \
+                lcg1State[n] = LCG1(lcg1State[n]);                                                          \
+                lcg2State[n] = LCG2(lcg2State[n]);                                                          \
+                result[n] = convert_uchar(((lcg1State[n] ^ lcg2State[n]) >> 16) & 0xff);                    \
+            }                                                                                               \
+            return;                                                                                         \
+        }                                                                                                   \
+    }                                                                                                       \
 }
 
-kernel void GenerateRandomNumber (
-    global uint* lcg1State,
-    global uint* lcg2State,
-    global uchar* result
-)
-{
-    ulong N = get_global_id(0);
-    result[N] = LCG1(lcg1State + N) ^ LCG2(lcg2State + N);
-}
+GENERATE_RANDOM_NUMBER(1)
+GENERATE_RANDOM_NUMBER(2)
+GENERATE_RANDOM_NUMBER(4)
+GENERATE_RANDOM_NUMBER(8)
 )";
 
 /* static */ bool CGPURandomSequenceGenerator::CheckClStatus(cl_int status, bool throwException)
@@ -126,27 +167,43 @@ kernel void GenerateRandomNumber (
     return clStatus == 0;
 }
 
-CGPURandomSequenceGenerator::CGPURandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback) :
-    CDoubleBuffersRandomSequenceGenerator(memorySizeInBytes, decreaseThreadPriorityCallback)
+CGPURandomSequenceGenerator::CGPURandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering, const std::optional<SStreamPosition>& startPosition) :
+    CDoubleBuffersRandomSequenceGenerator(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, startPosition)
 {
+    if (startPosition && !startPosition->_engineState.empty())
+    {
+        if (startPosition->_engineState.size() != sizeof(_fills))
+            throw std::runtime_error("Engine state of the snapshot is corrupted");
+
+        std::memcpy(&_fills, startPosition->_engineState.data(), sizeof(_fills));
+    }
+
     InitBase();
 }
 
 CGPURandomSequenceGenerator::~CGPURandomSequenceGenerator() noexcept
 {
-    StartThreadFinish();
+    StopThread();
 }
 
 void CGPURandomSequenceGenerator::FinishThread()
 {
-    cl_int clStatus;
-
-    clStatus = clReleaseKernel(_clKernel);              CheckClStatus(clStatus);
-    clStatus = clReleaseMemObject(_lce1);               CheckClStatus(clStatus);
-    clStatus = clReleaseMemObject(_lce2);               CheckClStatus(clStatus);
-    clStatus = clReleaseProgram(_program);              CheckClStatus(clStatus);
-    clStatus = clReleaseCommandQueue(_commandQueue);    CheckClStatus(clStatus);
-    clStatus = clReleaseContext(_context);              CheckClStatus(clStatus);
+    // Objects are released in the reverse order of the creation, the ones the failed init hasn't created are skipped.
+    // Errors are ignored, the device may be the reason of the failover
+    if (_clKernel)
+        clReleaseKernel(_clKernel);
+    if (_res)
+        clReleaseMemObject(_res);
+    if (_lce2)
+        clReleaseMemObject(_lce2);
+    if (_lce1)
+        clReleaseMemObject(_lce1);
+    if (_commandQueue)
+        clReleaseCommandQueue(_commandQueue);
+    if (_program)
+        clReleaseProgram(_program);
+    if (_context)
+        clReleaseContext(_context);
 }
 
 void CGPURandomSequenceGenerator::AllocBuffers(size_t buffers, size_t bytesInBuffer)
@@ -173,11 +230,20 @@ bool CGPURandomSequenceGenerator::ImplInit()
     if (clStatus)
         return false;
 
-    cl_uint num_devices;
+    cl_uint num_devices = 0;
+    cl_device_type deviceType = CL_DEVICE_TYPE_GPU;
+
+    // CPU OpenCL runtime runs the same kernel when there is no GPU
+    clStatus = clGetDeviceIDs(platforms[0], deviceType, 0, nullptr, &num_devices);
+    if (clStatus == CL_DEVICE_NOT_FOUND || num_devices == 0)
+    {
+        deviceType = CL_DEVICE_TYPE_ALL;
+        clStatus = clGetDeviceIDs(platforms[0], deviceType, 0, nullptr, &num_devices);
+    }
+    CheckClStatus(clStatus);
 
-    clStatus = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, 0, nullptr, &num_devices);  CheckClStatus(clStatus);
     std::vector<cl_device_id> device_list(num_devices);
-    clStatus = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, num_devices, device_list.data(), nullptr);  CheckClStatus(clStatus);
+    clStatus = clGetDeviceIDs(platforms[0], deviceType, num_devices, device_list.data(), nullptr);  CheckClStatus(clStatus);
 
     _context = clCreateContext(NULL, num_devices, device_list.data(), nullptr, nullptr, &clStatus); CheckClStatus(clStatus);
     if (clStatus)
@@ -201,10 +267,15 @@ bool CGPURandomSequenceGenerator::ImplInit()
         clGetProgramBuildInfo(_program, device_list[0], CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
         printf("%s \n", buffer);
     }
-    _commandQueue = clCreateCommandQueueWithProperties(_context, device_list[0], 0, &clStatus); CheckClStatus(clStatus);
+    // Kernel variants are timed by the profiling events
+    const cl_queue_properties queueProperties[] = { CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0 };
+    _commandQueue = clCreateCommandQueueWithProperties(_context, device_list[0], queueProperties, &clStatus); CheckClStatus(clStatus);
 
     std::mt19937_64 mtGen;
-    mtGen.seed(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()));
+    if (StartPosition())
+        mtGen.seed(StartPosition()->_seed);
+    else
+        mtGen.seed(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()));
     std::uniform_int_distribution<> distribution;
 
     const size_t bufferSize = BufferSize();
@@ -216,44 +287,42 @@ bool CGPURandomSequenceGenerator::ImplInit()
         lce2[i] = distribution(mtGen);
     }
 
-    _lce1 = clCreateBuffer(_context, CL_MEM_READ_WRITE, bufferSize * sizeof(decltype(lce1)::value_type), nullptr, &clStatus);  CheckClStatus(clStatus);
-    clStatus = clEnqueueWriteBuffer(_commandQueue, _lce1, CL_TRUE, 0, bufferSize * sizeof(decltype(lce1)::value_type), lce1.data(), 0, nullptr, nullptr); CheckClStatus(clStatus);
+    // Constants of LCG1 and LCG2 of the kernel
+    JumpLCG(lce1, 214013U, 2531011U, _fills);
+    JumpLCG(lce2, 1103515245U, 12345U, _fills);
 
+    _lce1 = clCreateBuffer(_context, CL_MEM_READ_WRITE, bufferSize * sizeof(decltype(lce1)::value_type), nullptr, &clStatus);  CheckClStatus(clStatus);
     _lce2 = clCreateBuffer(_context, CL_MEM_READ_WRITE, bufferSize * sizeof(decltype(lce2)::value_type), nullptr, &clStatus);  CheckClStatus(clStatus);
-    clStatus = clEnqueueWriteBuffer(_commandQueue, _lce2, CL_TRUE, 0, bufferSize * sizeof(decltype(lce2)::value_type), lce2.data(), 0, nullptr, nullptr); CheckClStatus(clStatus);
-
     _res = clCreateBuffer(_context, CL_MEM_WRITE_ONLY, bufferSize * sizeof(TByte), nullptr, &clStatus);  CheckClStatus(clStatus);
 
-    _clKernel = clCreateKernel(_program, "GenerateRandomNumber", &clStatus);      CheckClStatus(clStatus);
+    // Tuning runs the kernel variants over the buffers, the seeded states are uploaded after it
+    _kernelConfig = TunedKernelConfig(device_list[0]);
+    _clKernel = CreateKernel(_kernelConfig).release();
 
-    enum class EArgPos : cl_uint { lcg1State = 0, lcg2State, result };
-
-    auto setKernelArg = [this](EArgPos argPos, auto& arg)
-    {
-        using TArg = std::remove_reference_t<decltype(arg)>;
-        return clSetKernelArg(_clKernel, static_cast<cl_uint>(argPos), sizeof(TArg), static_cast<void*>(&arg));
-    };
-
-    clStatus = setKernelArg(EArgPos::lcg1State, _lce1); CheckClStatus(clStatus);
-    clStatus = setKernelArg(EArgPos::lcg2State, _lce2); CheckClStatus(clStatus);
-    clStatus = setKernelArg(EArgPos::result, _res);     CheckClStatus(clStatus);
+    clStatus = clEnqueueWriteBuffer(_commandQueue, _lce1, CL_TRUE, 0, bufferSize * sizeof(decltype(lce1)::value_type), lce1.data(), 0, nullptr, nullptr); CheckClStatus(clStatus);
+    clStatus = clEnqueueWriteBuffer(_commandQueue, _lce2, CL_TRUE, 0, bufferSize * sizeof(decltype(lce2)::value_type), lce2.data(), 0, nullptr, nullptr); CheckClStatus(clStatus);
 
     return true;
 }
 
-bool CGPURandomSequenceGenerator::FillBuffer(size_t bufferId)
+bool CGPURandomSequenceGenerator::FillBuffer(size_t bufferId, size_t offset, size_t size)
 {
     using namespace std::chrono;
 
     assert(bufferId < BuffersAmount());
+    assert(offset == 0 && size == BufferSize());
 
     size_t bufferSize = BufferSize();
+    const size_t globalWorkSize = GlobalWorkSize(_kernelConfig);
+    const size_t* localWorkSize = _kernelConfig._localSize ? &_kernelConfig._localSize : nullptr;
 
     auto startCalc = steady_clock::now();
-    cl_int clStatus = clEnqueueNDRangeKernel(_commandQueue, _clKernel, 1, nullptr, &bufferSize, nullptr, 0, nullptr, nullptr);     CheckClStatus(clStatus);
+    cl_int clStatus = clEnqueueNDRangeKernel(_commandQueue, _clKernel, 1, nullptr, &globalWorkSize, localWorkSize, 0, nullptr, nullptr);     CheckClStatus(clStatus);
     auto endCalc = steady_clock::now();
     auto calcDuration = endCalc - startCalc;
 
+    ++_fills;
+
     auto startRead = steady_clock::now();
 
     TBuffer& buf = _buf[bufferId];
@@ -268,7 +337,6 @@ bool CGPURandomSequenceGenerator::FillBuffer(size_t bufferId)
     SStatistics stat;
     stat._generate = std::chrono::duration_cast<SStatistics::TTimeMeasurement>(calcDuration);
     stat._store = std::chrono::duration_cast<SStatistics::TTimeMeasurement>(readDuration);
-    stat._bufSize = BufferSize();
 
     SetStatistics(stat);
 
@@ -280,3 +348,166 @@ CGPURandomSequenceGenerator::TByte* CGPURandomSequenceGenerator::Array(size_t bu
     assert(bufferId < BuffersAmount());
     return _buf[bufferId].data();
 }
+
+CGPURandomSequenceGenerator::TBuffer CGPURandomSequenceGenerator::EngineState() const
+{
+    TBuffer state(sizeof(_fills));
+    std::memcpy(state.data(), &_fills, sizeof(_fills));
+    return state;
+}
+
+CGPURandomSequenceGenerator::TKernel CGPURandomSequenceGenerator::CreateKernel(const SKernelConfig& config)
+{
+    const std::string kernelName = "GenerateRandomNumber" + std::to_string(config._vectorWidth);
+
+    cl_int clStatus;
+    TKernel kernel(clCreateKernel(_program, kernelName.c_str(), &clStatus));         CheckClStatus(clStatus);
+
+    enum class EArgPos : cl_uint { lcg1State = 0, lcg2State, result, size, itemsPerWorkItem };
+
+    auto setKernelArg = [&kernel](EArgPos argPos, auto& arg)
+    {
+        using TArg = std::remove_reference_t<decltype(arg)>;
+        return clSetKernelArg(kernel.get(), static_cast<cl_uint>(argPos), sizeof(TArg), static_cast<void*>(&arg));
+    };
+
+    cl_ulong size = BufferSize();
+    cl_uint itemsPerWorkItem = static_cast<cl_uint>(config._itemsPerWorkItem);
+
+    clStatus = setKernelArg(EArgPos::lcg1State, _lce1);                     CheckClStatus(clStatus);
+    clStatus = setKernelArg(EArgPos::lcg2State, _lce2);                     CheckClStatus(clStatus);
+    clStatus = setKernelArg(EArgPos::result, _res);                         CheckClStatus(clStatus);
+    clStatus = setKernelArg(EArgPos::size, size);                           CheckClStatus(clStatus);
+    clStatus = setKernelArg(EArgPos::itemsPerWorkItem, itemsPerWorkItem);   CheckClStatus(clStatus);
+
+    return kernel;
+}
+
+size_t CGPURandomSequenceGenerator::GlobalWorkSize(const SKernelConfig& config) const noexcept
+{
+    // Work items past the buffer end exit at once, the global size is rounded up to the work-group size
+    const size_t bytesPerWorkItem = config._itemsPerWorkItem * config._vectorWidth;
+    size_t workItems = (BufferSize() + bytesPerWorkItem - 1) / bytesPerWorkItem;
+    if (config._localSize)
+        workItems = (workItems + config._localSize - 1) / config._localSize * config._localSize;
+
+    return workItems;
+}
+
+cl_ulong CGPURandomSequenceGenerator::KernelDuration(cl_kernel kernel, const SKernelConfig& config)
+{
+    const size_t globalWorkSize = GlobalWorkSize(config);
+    const size_t* localWorkSize = config._localSize ? &config._localSize : nullptr;
+
+    // First run pays for the lazy initialization of the driver, the fastest of the rest is taken
+    cl_ulong duration = std::numeric_limits<cl_ulong>::max();
+    for (size_t run = 0; run <= _tuningRuns; ++run)
+    {
+        cl_event enqueuedEvent;
+        cl_int clStatus = clEnqueueNDRangeKernel(_commandQueue, kernel, 1, nullptr, &globalWorkSize, localWorkSize, 0, nullptr, &enqueuedEvent);
+        if (!CheckClStatus(clStatus, false))
+            return std::numeric_limits<cl_ulong>::max();
+        const TEvent event(enqueuedEvent);
+
+        cl_ulong start = 0;
+        cl_ulong end = 0;
+        clStatus = clWaitForEvents(1, &enqueuedEvent);                                                                  CheckClStatus(clStatus);
+        clStatus = clGetEventProfilingInfo(event.get(), CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr);    CheckClStatus(clStatus);
+        clStatus = clGetEventProfilingInfo(event.get(), CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);          CheckClStatus(clStatus);
+
+        if (run > 0)
+            duration = std::min(duration, end - start);
+    }
+
+    return duration;
+}
+
+CGPURandomSequenceGenerator::SKernelConfig CGPURandomSequenceGenerator::TunedKernelConfig(cl_device_id device)
+{
+    const CKernelConfigCache cache(CKernelConfigCache::UserCachePath());
+    const std::string deviceKey = DeviceKey(device);
+
+    // Cached variant is taken while its work-group still fits the kernel, the changed limit is tuned again
+    if (const std::optional<SKernelConfig> cachedConfig = cache.Load(deviceKey))
+        if (cachedConfig->_localSize <= MaxLocalSize(CreateKernel(*cachedConfig).get(), device))
+            return *cachedConfig;
+
+    SKernelConfig bestConfig;
+    cl_ulong bestDuration = std::numeric_limits<cl_ulong>::max();
+
+    for (size_t vectorWidth : CKernelConfigCache::_tunedVectorWidths)
+    {
+        for (size_t itemsPerWorkItem : CKernelConfigCache::_tunedItemsPerWorkItem)
+        {
+            SKernelConfig config;
+            config._vectorWidth = vectorWidth;
+            config._itemsPerWorkItem = itemsPerWorkItem;
+
+            const TKernel kernel = CreateKernel(config);
+            const size_t maxLocalSize = MaxLocalSize(kernel.get(), device);
+
+            for (size_t localSize : CKernelConfigCache::_tunedLocalSizes)
+            {
+                if (localSize > maxLocalSize)
+                    continue;
+
+                config._localSize = localSize;
+                const cl_ulong duration = KernelDuration(kernel.get(), config);
+                if (duration < bestDuration)
+                {
+                    bestDuration = duration;
+                    bestConfig = config;
+                }
+            }
+        }
+    }
+
+    cache.Store(deviceKey, bestConfig);
+    return bestConfig;
+}
+
+/* static */ size_t CGPURandomSequenceGenerator::MaxLocalSize(cl_kernel kernel, cl_device_id device)
+{
+    size_t maxLocalSize = 0;
+    cl_int clStatus = clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(maxLocalSize), &maxLocalSize, nullptr);  CheckClStatus(clStatus);
+    return maxLocalSize;
+}
+
+/* static */ std::string CGPURandomSequenceGenerator::DeviceKey(cl_device_id device)
+{
+    auto deviceInfo = [device](cl_device_info info)
+    {
+        size_t size = 0;
+        cl_int clStatus = clGetDeviceInfo(device, info, 0, nullptr, &size);           CheckClStatus(clStatus);
+        std::string value(size, '\0');
+        clStatus = clGetDeviceInfo(device, info, size, value.data(), nullptr);       CheckClStatus(clStatus);
+
+        // Separators of the cache file never appear in the key
+        value.erase(std::find(value.begin(), value.end(), '\0'), value.end());
+        std::replace_if(value.begin(), value.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+        return value;
+    };
+
+    return deviceInfo(CL_DEVICE_NAME) + " / " + deviceInfo(CL_DEVICE_VENDOR) + " / " + deviceInfo(CL_DRIVER_VERSION);
+}
+
+/* static */ void CGPURandomSequenceGenerator::JumpLCG(std::vector<uint32_t>& states, uint32_t multiplier, uint32_t increment, uint64_t steps) noexcept
+{
+    // Steps are composed by squaring : x -> a * x + c twice is x -> a^2 * x + (a + 1) * c
+    uint32_t jumpMultiplier = 1;
+    uint32_t jumpIncrement = 0;
+    for (; steps; steps >>= 1)
+    {
+        if (steps & 1)
+        {
+            jumpMultiplier *= multiplier;
+            jumpIncrement = jumpIncrement * multiplier + increment;
+        }
+
+        increment *= multiplier + 1;
+        multiplier *= multiplier;
+    }
+
+    for (uint32_t& state : states)
+        state = state * jumpMultiplier + jumpIncrement;
+}
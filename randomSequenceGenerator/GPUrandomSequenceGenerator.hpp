@@ -3,7 +3,10 @@
 #define RANDOM_SEQUENCE_GENERATOR_GPU_IMPLEMENTATION_
 
 #include <memory>
+#include <optional>
 #include <random>
+#include <string>
+#include <type_traits>
 
 #ifdef __APPLE__
 #include <OpenCL/cl.h>
@@ -11,36 +14,64 @@
 #include <CL/cl.h>
 #endif
 
-#include "doubleBuffersRandomSequenceGenerator.hpp"
+#include "include/doubleBuffersRandomSequenceGenerator.hpp"
+#include "include/kernelConfigCache.hpp"
 
 class CGPURandomSequenceGenerator : public CDoubleBuffersRandomSequenceGenerator
 {
 public:
-    CGPURandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback);
+    CGPURandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback = nullptr, const SBuffering& buffering = {}, const std::optional<SStreamPosition>& startPosition = std::nullopt);
     ~CGPURandomSequenceGenerator() noexcept override;
 
     static bool CheckOpenCLdevicesAvailability();
 
 private:
+    using SKernelConfig = CKernelConfigCache::SKernelConfig;
+
+    // OpenCL objects of the tuning are released on the way out of the throwing checks
+    template <auto release>
+    struct SClReleaser
+    {
+        void operator()(auto object) const noexcept { release(object); }
+    };
+    using TKernel = std::unique_ptr<std::remove_pointer_t<cl_kernel>, SClReleaser<clReleaseKernel>>;
+    using TEvent = std::unique_ptr<std::remove_pointer_t<cl_event>, SClReleaser<clReleaseEvent>>;
+
     static const std::string _clProgram;
+    static constexpr size_t _tuningRuns = 3;
 
     std::vector<TBuffer> _buf;
+    // Every fill steps each of the kernel LCGs once, the state is restored by the jump ahead from the seeded one
+    uint64_t _fills = 0;
 
-    cl_context _context;
-    cl_program _program;
-    cl_command_queue _commandQueue;
-    cl_kernel _clKernel;
-    cl_mem _lce1;
-    cl_mem _lce2;
-    cl_mem _res;
+    cl_context _context = nullptr;
+    cl_program _program = nullptr;
+    cl_command_queue _commandQueue = nullptr;
+    cl_kernel _clKernel = nullptr;
+    SKernelConfig _kernelConfig;
+    cl_mem _lce1 = nullptr;
+    cl_mem _lce2 = nullptr;
+    cl_mem _res = nullptr;
 
     void AllocBuffers(size_t buffers, size_t bytesInBuffer) override;
     bool ImplInit() override;
-    bool FillBuffer(size_t bufferNum) override;
+    bool FillBuffer(size_t bufferNum, size_t offset, size_t size) override;
+    // Kernel fills the whole buffer, it is published at once
+    size_t ChunkSize() const noexcept override { return BufferSize(); }
     void FinishThread() override;
     TByte* Array(size_t bufferNum) noexcept override;
+    TBuffer EngineState() const override;
+    EGeneratorType GeneratorType() const noexcept override { return GPU_GENERATOR; }
+
+    TKernel CreateKernel(const SKernelConfig& config);
+    size_t GlobalWorkSize(const SKernelConfig& config) const noexcept;
+    cl_ulong KernelDuration(cl_kernel kernel, const SKernelConfig& config);
+    SKernelConfig TunedKernelConfig(cl_device_id device);
 
     static bool CheckClStatus(cl_int status, bool throwException = true);
+    static size_t MaxLocalSize(cl_kernel kernel, cl_device_id device);
+    static std::string DeviceKey(cl_device_id device);
+    static void JumpLCG(std::vector<uint32_t>& states, uint32_t multiplier, uint32_t increment, uint64_t steps) noexcept;
 };
 
 #endif // RANDOM_SEQUENCE_GENERATOR_CPU_IMPLEMENTATION_
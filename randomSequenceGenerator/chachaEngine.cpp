@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <Windows.h>
+    #include <bcrypt.h>
+    #pragma comment(lib, "bcrypt.lib")
+#elif defined(__APPLE__)
+    #include <sys/random.h>
+#else // _WIN32
+    #include <cerrno>
+    #include <sys/random.h>
+#endif // _WIN32
+
+#include "cpuFeatures.hpp"
+#include "include/chachaEngine.hpp"
+
+static_assert(std::endian::native == std::endian::little, "Keystream words are stored as they are in memory");
+
+#define CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, a, b, c, d) \
+    a = ADD(a, b); d = XOR(d, a); d = ROTL(d, 16); \
+    c = ADD(c, d); b = XOR(b, c); b = ROTL(b, 12); \
+    a = ADD(a, b); d = XOR(d, a); d = ROTL(d, 8);  \
+    c = ADD(c, d); b = XOR(b, c); b = ROTL(b, 7);
+
+#define CHACHA_DOUBLE_ROUND(ADD, XOR, ROTL, x) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[0], x[4], x[8], x[12]) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[1], x[5], x[9], x[13]) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[2], x[6], x[10], x[14]) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[3], x[7], x[11], x[15]) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[0], x[5], x[10], x[15]) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[1], x[6], x[11], x[12]) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[2], x[7], x[8], x[13]) \
+    CHACHA_QUARTER_ROUND(ADD, XOR, ROTL, x[3], x[4], x[9], x[14])
+
+static constexpr size_t chachaBlockSize = 64;
+static constexpr size_t chachaCounterWord = 12;
+
+static size_t ScalarBlocks(const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept
+{
+    #define SCALAR_ADD(a, b) ((a) + (b))
+    #define SCALAR_XOR(a, b) ((a) ^ (b))
+    #define SCALAR_ROTL(a, c) std::rotl(a, c)
+
+    for (size_t block = 0; block < blocks; ++block, ++counter, data += chachaBlockSize)
+    {
+        uint32_t input[16];
+        std::memcpy(input, state, sizeof(input));
+        input[chachaCounterWord] = static_cast<uint32_t>(counter);
+        input[chachaCounterWord + 1] = static_cast<uint32_t>(counter >> 32);
+
+        uint32_t x[16];
+        std::memcpy(x, input, sizeof(x));
+        for (size_t round = 0; round < rounds; round += 2)
+        {
+            CHACHA_DOUBLE_ROUND(SCALAR_ADD, SCALAR_XOR, SCALAR_ROTL, x)
+        }
+
+        for (size_t i = 0; i < 16; ++i)
+            x[i] += input[i];
+        std::memcpy(data, x, sizeof(x));
+    }
+
+    #undef SCALAR_ADD
+    #undef SCALAR_XOR
+    #undef SCALAR_ROTL
+
+    return blocks;
+}
+
+#ifdef RANDOM_SEQUENCE_GENERATOR_SSE2
+// Lane per block : every register holds the same state word of 4 blocks, the result is transposed back to the blocks
+static size_t SSE2Blocks(const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept
+{
+    #define SSE2_ROTL(a, c) _mm_or_si128(_mm_slli_epi32(a, c), _mm_srli_epi32(a, 32 - (c)))
+
+    constexpr size_t lanes = 4;
+    size_t block = 0;
+    for (; block + lanes <= blocks; block += lanes, counter += lanes, data += lanes * chachaBlockSize)
+    {
+        __m128i input[16];
+        for (size_t i = 0; i < 16; ++i)
+            input[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+
+        alignas(16) uint32_t counterLow[lanes];
+        alignas(16) uint32_t counterHigh[lanes];
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            counterLow[lane] = static_cast<uint32_t>(counter + lane);
+            counterHigh[lane] = static_cast<uint32_t>((counter + lane) >> 32);
+        }
+        input[chachaCounterWord] = _mm_load_si128(reinterpret_cast<const __m128i*>(counterLow));
+        input[chachaCounterWord + 1] = _mm_load_si128(reinterpret_cast<const __m128i*>(counterHigh));
+
+        __m128i x[16];
+        for (size_t i = 0; i < 16; ++i)
+            x[i] = input[i];
+
+        for (size_t round = 0; round < rounds; round += 2)
+        {
+            CHACHA_DOUBLE_ROUND(_mm_add_epi32, _mm_xor_si128, SSE2_ROTL, x)
+        }
+
+        for (size_t group = 0; group < 4; ++group)
+        {
+            const __m128i a = _mm_add_epi32(x[4 * group], input[4 * group]);
+            const __m128i b = _mm_add_epi32(x[4 * group + 1], input[4 * group + 1]);
+            const __m128i c = _mm_add_epi32(x[4 * group + 2], input[4 * group + 2]);
+            const __m128i d = _mm_add_epi32(x[4 * group + 3], input[4 * group + 3]);
+
+            const __m128i ab01 = _mm_unpacklo_epi32(a, b);
+            const __m128i cd01 = _mm_unpacklo_epi32(c, d);
+            const __m128i ab23 = _mm_unpackhi_epi32(a, b);
+            const __m128i cd23 = _mm_unpackhi_epi32(c, d);
+
+            uint8_t* groupData = data + group * sizeof(__m128i);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(groupData), _mm_unpacklo_epi64(ab01, cd01));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(groupData + chachaBlockSize), _mm_unpackhi_epi64(ab01, cd01));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(groupData + 2 * chachaBlockSize), _mm_unpacklo_epi64(ab23, cd23));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(groupData + 3 * chachaBlockSize), _mm_unpackhi_epi64(ab23, cd23));
+        }
+    }
+
+    #undef SSE2_ROTL
+
+    return block;
+}
+#endif // RANDOM_SEQUENCE_GENERATOR_SSE2
+
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+RANDOM_SEQUENCE_GENERATOR_TARGET("avx2")
+static size_t AVX2Blocks(const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept
+{
+    const __m256i rotate16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rotate8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14, 3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+    #define AVX2_ROTL(a, c) ((c) == 16 ? _mm256_shuffle_epi8(a, rotate16) : (c) == 8 ? _mm256_shuffle_epi8(a, rotate8) : \
+        _mm256_or_si256(_mm256_slli_epi32(a, c), _mm256_srli_epi32(a, 32 - (c))))
+
+    constexpr size_t lanes = 8;
+    size_t block = 0;
+    for (; block + lanes <= blocks; block += lanes, counter += lanes, data += lanes * chachaBlockSize)
+    {
+        __m256i input[16];
+        for (size_t i = 0; i < 16; ++i)
+            input[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+
+        alignas(32) uint32_t counterLow[lanes];
+        alignas(32) uint32_t counterHigh[lanes];
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            counterLow[lane] = static_cast<uint32_t>(counter + lane);
+            counterHigh[lane] = static_cast<uint32_t>((counter + lane) >> 32);
+        }
+        input[chachaCounterWord] = _mm256_load_si256(reinterpret_cast<const __m256i*>(counterLow));
+        input[chachaCounterWord + 1] = _mm256_load_si256(reinterpret_cast<const __m256i*>(counterHigh));
+
+        __m256i x[16];
+        for (size_t i = 0; i < 16; ++i)
+            x[i] = input[i];
+
+        for (size_t round = 0; round < rounds; round += 2)
+        {
+            CHACHA_DOUBLE_ROUND(_mm256_add_epi32, _mm256_xor_si256, AVX2_ROTL, x)
+        }
+
+        // Every 128-bit lane is transposed as in SSE2 kernel : lane 0 keeps the blocks 0..3, lane 1 keeps the blocks 4..7
+        __m256i words[4][4];
+        for (size_t group = 0; group < 4; ++group)
+        {
+            const __m256i a = _mm256_add_epi32(x[4 * group], input[4 * group]);
+            const __m256i b = _mm256_add_epi32(x[4 * group + 1], input[4 * group + 1]);
+            const __m256i c = _mm256_add_epi32(x[4 * group + 2], input[4 * group + 2]);
+            const __m256i d = _mm256_add_epi32(x[4 * group + 3], input[4 * group + 3]);
+
+            const __m256i ab01 = _mm256_unpacklo_epi32(a, b);
+            const __m256i cd01 = _mm256_unpacklo_epi32(c, d);
+            const __m256i ab23 = _mm256_unpackhi_epi32(a, b);
+            const __m256i cd23 = _mm256_unpackhi_epi32(c, d);
+
+            words[group][0] = _mm256_unpacklo_epi64(ab01, cd01);
+            words[group][1] = _mm256_unpackhi_epi64(ab01, cd01);
+            words[group][2] = _mm256_unpacklo_epi64(ab23, cd23);
+            words[group][3] = _mm256_unpackhi_epi64(ab23, cd23);
+        }
+
+        for (size_t lane = 0; lane < 4; ++lane)
+        {
+            uint8_t* lowBlock = data + lane * chachaBlockSize;
+            uint8_t* highBlock = data + (lane + 4) * chachaBlockSize;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lowBlock), _mm256_permute2x128_si256(words[0][lane], words[1][lane], 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lowBlock + sizeof(__m256i)), _mm256_permute2x128_si256(words[2][lane], words[3][lane], 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(highBlock), _mm256_permute2x128_si256(words[0][lane], words[1][lane], 0x31));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(highBlock + sizeof(__m256i)), _mm256_permute2x128_si256(words[2][lane], words[3][lane], 0x31));
+        }
+    }
+
+    #undef AVX2_ROTL
+
+    return block;
+}
+
+RANDOM_SEQUENCE_GENERATOR_TARGET("avx512f")
+static size_t AVX512Blocks(const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept
+{
+    constexpr size_t lanes = 16;
+    size_t block = 0;
+    for (; block + lanes <= blocks; block += lanes, counter += lanes, data += lanes * chachaBlockSize)
+    {
+        __m512i input[16];
+        for (size_t i = 0; i < 16; ++i)
+            input[i] = _mm512_set1_epi32(static_cast<int>(state[i]));
+
+        alignas(64) uint32_t counterLow[lanes];
+        alignas(64) uint32_t counterHigh[lanes];
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            counterLow[lane] = static_cast<uint32_t>(counter + lane);
+            counterHigh[lane] = static_cast<uint32_t>((counter + lane) >> 32);
+        }
+        input[chachaCounterWord] = _mm512_load_si512(counterLow);
+        input[chachaCounterWord + 1] = _mm512_load_si512(counterHigh);
+
+        __m512i x[16];
+        for (size_t i = 0; i < 16; ++i)
+            x[i] = input[i];
+
+        for (size_t round = 0; round < rounds; round += 2)
+        {
+            CHACHA_DOUBLE_ROUND(_mm512_add_epi32, _mm512_xor_si512, _mm512_rol_epi32, x)
+        }
+
+        // Every 128-bit lane is transposed as in SSE2 kernel, the lane n keeps the blocks 4n..4n+3
+        __m512i words[4][4];
+        for (size_t group = 0; group < 4; ++group)
+        {
+            const __m512i a = _mm512_add_epi32(x[4 * group], input[4 * group]);
+            const __m512i b = _mm512_add_epi32(x[4 * group + 1], input[4 * group + 1]);
+            const __m512i c = _mm512_add_epi32(x[4 * group + 2], input[4 * group + 2]);
+            const __m512i d = _mm512_add_epi32(x[4 * group + 3], input[4 * group + 3]);
+
+            const __m512i ab01 = _mm512_unpacklo_epi32(a, b);
+            const __m512i cd01 = _mm512_unpacklo_epi32(c, d);
+            const __m512i ab23 = _mm512_unpackhi_epi32(a, b);
+            const __m512i cd23 = _mm512_unpackhi_epi32(c, d);
+
+            words[group][0] = _mm512_unpacklo_epi64(ab01, cd01);
+            words[group][1] = _mm512_unpackhi_epi64(ab01, cd01);
+            words[group][2] = _mm512_unpacklo_epi64(ab23, cd23);
+            words[group][3] = _mm512_unpackhi_epi64(ab23, cd23);
+        }
+
+        for (size_t lane = 0; lane < 4; ++lane)
+        {
+            const __m512i groups01Low = _mm512_shuffle_i32x4(words[0][lane], words[1][lane], 0x44);
+            const __m512i groups23Low = _mm512_shuffle_i32x4(words[2][lane], words[3][lane], 0x44);
+            const __m512i groups01High = _mm512_shuffle_i32x4(words[0][lane], words[1][lane], 0xee);
+            const __m512i groups23High = _mm512_shuffle_i32x4(words[2][lane], words[3][lane], 0xee);
+
+            _mm512_storeu_si512(data + lane * chachaBlockSize, _mm512_shuffle_i32x4(groups01Low, groups23Low, 0x88));
+            _mm512_storeu_si512(data + (lane + 4) * chachaBlockSize, _mm512_shuffle_i32x4(groups01Low, groups23Low, 0xdd));
+            _mm512_storeu_si512(data + (lane + 8) * chachaBlockSize, _mm512_shuffle_i32x4(groups01High, groups23High, 0x88));
+            _mm512_storeu_si512(data + (lane + 12) * chachaBlockSize, _mm512_shuffle_i32x4(groups01High, groups23High, 0xdd));
+        }
+    }
+
+    return block;
+}
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+
+/* static */ void CChaChaEngine::KeystreamBlocks(const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept
+{
+    using FBlocks = size_t(*)(const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept;
+
+    // Widest kernel takes the most of the blocks, the narrower ones finish the rest
+    static const std::array<FBlocks, 3> kernels = []()
+    {
+        std::array<FBlocks, 3> kernels{ nullptr, nullptr, nullptr };
+        size_t kernel = 0;
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+        if (CPUSupportsAVX512())
+            kernels[kernel++] = AVX512Blocks;
+        if (CPUSupportsAVX2())
+            kernels[kernel++] = AVX2Blocks;
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+#ifdef RANDOM_SEQUENCE_GENERATOR_SSE2
+        kernels[kernel++] = SSE2Blocks;
+#endif // RANDOM_SEQUENCE_GENERATOR_SSE2
+        return kernels;
+    }();
+
+    for (FBlocks kernel : kernels)
+    {
+        if (!kernel)
+            break;
+
+        const size_t done = kernel(state, counter, rounds, data, blocks);
+        counter += done;
+        data += done * chachaBlockSize;
+        blocks -= done;
+    }
+
+    ScalarBlocks(state, counter, rounds, data, blocks);
+}
+
+/* static */ std::vector<CChaChaEngine::EKernel> CChaChaEngine::SupportedKernels()
+{
+    std::vector<EKernel> kernels{ SCALAR_KERNEL };
+#ifdef RANDOM_SEQUENCE_GENERATOR_SSE2
+    kernels.push_back(SSE2_KERNEL);
+#endif // RANDOM_SEQUENCE_GENERATOR_SSE2
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+    if (CPUSupportsAVX2())
+        kernels.push_back(AVX2_KERNEL);
+    if (CPUSupportsAVX512())
+        kernels.push_back(AVX512_KERNEL);
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+    return kernels;
+}
+
+/* static */ void CChaChaEngine::KernelBlocks(EKernel kernel, const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept
+{
+    size_t done = 0;
+    switch (kernel)
+    {
+#ifdef RANDOM_SEQUENCE_GENERATOR_SSE2
+    case SSE2_KERNEL:
+        done = SSE2Blocks(state, counter, rounds, data, blocks);
+        break;
+#endif // RANDOM_SEQUENCE_GENERATOR_SSE2
+
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+    case AVX2_KERNEL:
+        done = AVX2Blocks(state, counter, rounds, data, blocks);
+        break;
+
+    case AVX512_KERNEL:
+        done = AVX512Blocks(state, counter, rounds, data, blocks);
+        break;
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+
+    default:
+        break;
+    }
+
+    ScalarBlocks(state, counter + done, rounds, data + done * chachaBlockSize, blocks - done);
+}
+
+/* static */ void CChaChaEngine::OSRandomBytes(uint8_t* data, size_t size)
+{
+#ifdef _WIN32
+    if (!BCRYPT_SUCCESS(BCryptGenRandom(nullptr, data, static_cast<ULONG>(size), BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+        throw std::runtime_error("OS random number generator has failed");
+#elif defined(__APPLE__)
+    // getentropy gives up to 256 bytes per call
+    constexpr size_t maxChunk = 256;
+    for (size_t offset = 0; offset < size; offset += maxChunk)
+        if (getentropy(data + offset, std::min(maxChunk, size - offset)) != 0)
+            throw std::runtime_error("OS random number generator has failed");
+#else // _WIN32
+    size_t offset = 0;
+    while (offset < size)
+    {
+        const ssize_t received = getrandom(data + offset, size - offset, 0);
+        if (received < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            using namespace std::string_literals;
+            throw std::runtime_error("OS random number generator has failed, errno "s + std::to_string(errno));
+        }
+        offset += static_cast<size_t>(received);
+    }
+#endif // _WIN32
+}
+
+CChaChaEngine::CChaChaEngine(size_t rounds) :
+    _rounds(rounds)
+{
+    assert(rounds == 8 || rounds == 12 || rounds == 20);
+
+    // "expand 32-byte k"
+    _state = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+}
+
+CChaChaEngine::~CChaChaEngine() noexcept
+{
+    volatile uint32_t* state = _state.data();
+    for (size_t i = 0; i < _state.size(); ++i)
+        state[i] = 0;
+}
+
+void CChaChaEngine::Seed(const TKey& key) noexcept
+{
+    for (size_t i = 0; i < _keyWords; ++i)
+    {
+        uint32_t word;
+        std::memcpy(&word, key.data() + i * sizeof(word), sizeof(word));
+        _state[_keyWord + i] ^= word;
+    }
+}
+
+CChaChaEngine::TKey CChaChaEngine::Key() const noexcept
+{
+    TKey key;
+    std::memcpy(key.data(), _state.data() + _keyWord, key.size());
+    return key;
+}
+
+void CChaChaEngine::SetKey(const TKey& key) noexcept
+{
+    std::memcpy(_state.data() + _keyWord, key.data(), key.size());
+}
+
+void CChaChaEngine::Generate(uint8_t* data, size_t size) noexcept
+{
+    const size_t blocks = size / _blockSize;
+    KeystreamBlocks(_state.data(), 0, _rounds, data, blocks);
+
+    // Tail of the output and the next key come from the last two blocks
+    std::array<uint8_t, 2 * _blockSize> lastBlocks;
+    KeystreamBlocks(_state.data(), blocks, _rounds, lastBlocks.data(), 2);
+
+    const size_t tail = size - blocks * _blockSize;
+    std::memcpy(data + blocks * _blockSize, lastBlocks.data(), tail);
+    std::memcpy(_state.data() + _keyWord, lastBlocks.data() + _blockSize, _keyWords * sizeof(uint32_t));
+
+    volatile uint8_t* erased = lastBlocks.data();
+    for (size_t i = 0; i < lastBlocks.size(); ++i)
+        erased[i] = 0;
+}
@@ -0,0 +1,124 @@
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "include/randomSequenceGenerator.hpp"
+#include "chachaRandomSequenceGenerator.hpp"
+
+CChaChaRandomSequenceGenerator::CChaChaRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, size_t rounds, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering, const std::optional<SStreamPosition>& startPosition) :
+    CDoubleBuffersRandomSequenceGenerator(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, startPosition), _rounds(rounds), _engine(rounds)
+{
+    CChaChaEngine::TKey key;
+
+    if (startPosition && !startPosition->_engineState.empty())
+    {
+        if (startPosition->_engineState.size() != key.size())
+            throw std::runtime_error("Engine state of the snapshot is corrupted");
+
+        std::memcpy(key.data(), startPosition->_engineState.data(), key.size());
+        _engine.SetKey(key);
+    }
+    else if (startPosition)
+    {
+        // SplitMix64 spreads the seed over the whole key
+        uint64_t seed = startPosition->_seed;
+        for (size_t i = 0; i < key.size(); i += sizeof(uint64_t))
+        {
+            uint64_t word = (seed += 0x9e3779b97f4a7c15ULL);
+            word = (word ^ (word >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            word = (word ^ (word >> 27)) * 0x94d049bb133111ebULL;
+            word ^= word >> 31;
+            std::memcpy(key.data() + i, &word, sizeof(word));
+        }
+        _engine.SetKey(key);
+    }
+
+    key.fill(0);
+
+    InitBase();
+}
+
+CChaChaRandomSequenceGenerator::~CChaChaRandomSequenceGenerator() noexcept
+{
+    StopThread();
+}
+
+void CChaChaRandomSequenceGenerator::AllocBuffers(size_t buffers, size_t bytesInBuffer)
+{
+    _buffer.resize(buffers);
+
+    for (size_t i = 0; i < buffers; ++i)
+        _buffer[i].resize(bytesInBuffer);
+}
+
+bool CChaChaRandomSequenceGenerator::ImplInit()
+{
+    if (!StartPosition())
+        Reseed();
+
+    return true;
+}
+
+void CChaChaRandomSequenceGenerator::Reseed()
+{
+    CChaChaEngine::TKey key;
+    CChaChaEngine::OSRandomBytes(key.data(), key.size());
+    _engine.Seed(key);
+    key.fill(0);
+
+    _bytesSinceReseed = 0;
+    _reseedTimePoint = std::chrono::steady_clock::now();
+}
+
+bool CChaChaRandomSequenceGenerator::FillBuffer(size_t bufferId, size_t offset, size_t size)
+{
+    assert(bufferId < _buffer.size());
+    assert(offset + size <= _buffer[bufferId].size());
+
+    const auto startTimePoint = std::chrono::steady_clock::now();
+
+    if (offset == 0 && !StartPosition() && (_bytesSinceReseed >= _reseedBytes || startTimePoint - _reseedTimePoint >= _reseedPeriod))
+        Reseed();
+
+    // Key is replaced after every chunk, the published bytes can't be recovered from the engine
+    _engine.Generate(_buffer[bufferId].data() + offset, size);
+    _bytesSinceReseed += size;
+
+    const auto endTimePoint = std::chrono::steady_clock::now();
+
+    SStatistics stat;
+    stat._generate = std::chrono::duration_cast<SStatistics::TTimeMeasurement>(endTimePoint - startTimePoint);
+    stat._store = SStatistics::TTimeMeasurement{ 0 };
+
+    SetStatistics(stat);
+
+    return true;
+}
+
+CChaChaRandomSequenceGenerator::TByte* CChaChaRandomSequenceGenerator::Array(size_t bufferId) noexcept
+{
+    assert(bufferId < _buffer.size());
+    return _buffer[bufferId].data();
+}
+
+CChaChaRandomSequenceGenerator::TBuffer CChaChaRandomSequenceGenerator::EngineState() const
+{
+    const CChaChaEngine::TKey key = _engine.Key();
+    return TBuffer(key.begin(), key.end());
+}
+
+CRandomSequenceGenerator::EGeneratorType CChaChaRandomSequenceGenerator::GeneratorType() const noexcept
+{
+    switch (_rounds)
+    {
+    case 8:
+        return CHACHA8_GENERATOR;
+
+    case 12:
+        return CHACHA12_GENERATOR;
+
+    default:
+        assert(_rounds == 20);
+        return CHACHA20_GENERATOR;
+    }
+}
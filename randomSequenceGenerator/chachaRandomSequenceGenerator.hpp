@@ -0,0 +1,40 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_CHACHA_IMPLEMENTATION_
+#define RANDOM_SEQUENCE_GENERATOR_CHACHA_IMPLEMENTATION_
+
+#include <chrono>
+#include <vector>
+
+#include "include/doubleBuffersRandomSequenceGenerator.hpp"
+#include "include/chachaEngine.hpp"
+
+// Cryptographically secure generator : ChaCha keystream with the key erased after every published chunk,
+// the key is reseeded from the OS random number generator periodically unless the generator is explicitly seeded
+class CChaChaRandomSequenceGenerator : public CDoubleBuffersRandomSequenceGenerator
+{
+public:
+    CChaChaRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, size_t rounds, FHealthTestFailed healthTestFailedCallback = nullptr, const SBuffering& buffering = {}, const std::optional<SStreamPosition>& startPosition = std::nullopt);
+    ~CChaChaRandomSequenceGenerator() noexcept override;
+
+private:
+    static constexpr size_t _reseedBytes = size_t{ 1 } << 30;
+    static constexpr std::chrono::seconds _reseedPeriod{ 60 };
+
+    const size_t _rounds;
+    CChaChaEngine _engine;
+    std::vector<TBuffer> _buffer;
+    size_t _bytesSinceReseed = 0;
+    std::chrono::steady_clock::time_point _reseedTimePoint;
+
+    void AllocBuffers(size_t buffers, size_t bytesInBuffer) override;
+    bool ImplInit() override;
+    bool FillBuffer(size_t bufferNum, size_t offset, size_t size) override;
+    TByte* Array(size_t bufferNum) noexcept override;
+    TBuffer EngineState() const override;
+    EGeneratorType GeneratorType() const noexcept override;
+    // Keystream is never replaced by the non-cryptographic CPU engine, the consumers get the error instead
+    bool FailoverAllowed() const noexcept override { return false; }
+
+    void Reseed();
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_CHACHA_IMPLEMENTATION_
@@ -0,0 +1,50 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_CPU_FEATURES_
+#define RANDOM_SEQUENCE_GENERATOR_CPU_FEATURES_
+
+// Wider kernels are compiled for their instruction set only and chosen at runtime by the features of the CPU
+
+#if defined(_M_X64) || defined(__SSE2__)
+    #include <emmintrin.h>
+    #define RANDOM_SEQUENCE_GENERATOR_SSE2
+#endif // defined(_M_X64) || defined(__SSE2__)
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #include <immintrin.h>
+    #define RANDOM_SEQUENCE_GENERATOR_AVX
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define RANDOM_SEQUENCE_GENERATOR_TARGET(instructionSet)
+    #else // _MSC_VER
+        #define RANDOM_SEQUENCE_GENERATOR_TARGET(instructionSet) __attribute__((target(instructionSet)))
+    #endif // _MSC_VER
+#endif // defined(_M_X64) || defined(__x86_64__)
+
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+inline bool CPUSupportsAVX2() noexcept
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else // _MSC_VER
+    return __builtin_cpu_supports("avx2");
+#endif // _MSC_VER
+}
+
+inline bool CPUSupportsAVX512() noexcept
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osSavesZmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0xe6) == 0xe6;
+    __cpuidex(info, 7, 0);
+    return osSavesZmm && (info[1] & (1 << 16));
+#else // _MSC_VER
+    return __builtin_cpu_supports("avx512f");
+#endif // _MSC_VER
+}
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+
+#endif // RANDOM_SEQUENCE_GENERATOR_CPU_FEATURES_
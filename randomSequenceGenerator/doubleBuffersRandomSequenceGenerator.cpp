@@ -1,15 +1,46 @@
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <thread>
 
-#include "doubleBuffersRandomSequenceGenerator.hpp"
+#include "include/doubleBuffersRandomSequenceGenerator.hpp"
+#include "include/randomSequenceGeneratorTemplate.hpp"
+#include "healthTests.hpp"
 
-CDoubleBuffersRandomSequenceGenerator::CDoubleBuffersRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback) :
-    CRandomSequenceGenerator(memorySizeInBytes), _decreaseThreadPriorityCallback(decreaseThreadPriorityCallback)
+CDoubleBuffersRandomSequenceGenerator::CDoubleBuffersRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering, const std::optional<SStreamPosition>& startPosition, bool singleConsumer) :
+    CRandomSequenceGenerator(memorySizeInBytes), _buffersAmount(buffering._minBuffers), _buffering(buffering), _startPosition(startPosition),
+    _lowWaterMarkBytes(static_cast<size_t>(buffering._lowWaterMark * memorySizeInBytes)), _singleConsumer(singleConsumer), _getRandomNumberMutex(singleConsumer),
+    _decreaseThreadPriorityCallback(decreaseThreadPriorityCallback), _healthTestFailedCallback(healthTestFailedCallback)
 {
+    using namespace std::string_literals;
+
+    if (_buffering._minBuffers < 2 || _buffering._maxBuffers < _buffering._minBuffers || _buffering._maxBuffers > _maxBuffersAmount)
+        throw std::out_of_range("Buffers amount should be within 2.."s + std::to_string(_maxBuffersAmount) + " and the min buffers should not exceed the max buffers"s);
+
+    // Shrinking takes the buffer away only when no consumer holds the lock
+    if (_singleConsumer && _buffering._minBuffers != _buffering._maxBuffers)
+        throw std::invalid_argument("Ring of the single consumer generator can't be resized, the min and the max buffers should be equal");
+
+    if (!(_buffering._lowWaterMark >= 0.0 && _buffering._lowWaterMark <= 1.0))
+        throw std::out_of_range("Low-water mark should be the part of the buffer within 0..1");
+
+    if (_startPosition && _startPosition->_consumed >= memorySizeInBytes)
+        throw std::out_of_range("Start position "s + std::to_string(_startPosition->_consumed) + " is beyond the buffer size "s + std::to_string(memorySizeInBytes));
+
+    if (_healthTestFailedCallback)
+        _healthTests = std::make_unique<CHealthTests>();
+}
+
+CDoubleBuffersRandomSequenceGenerator::~CDoubleBuffersRandomSequenceGenerator() noexcept
+{
+    // Implementation has already stopped the thread, the virtual functions it calls are gone here
+    assert(!_calcThread.joinable());
+    StopThread();
 }
 
 void CDoubleBuffersRandomSequenceGenerator::InitBase()
@@ -17,9 +48,12 @@ void CDoubleBuffersRandomSequenceGenerator::InitBase()
     AllocBuffers(BuffersAmount(), BufferSize());
 
     for (size_t i = 0; i < BuffersAmount(); ++i)
+    {
         _buffer[i]._buffer = Array(i);
+        _buffer[i]._next = (i + 1) % BuffersAmount();
+    }
 
-    _calcThread = std::make_unique<std::thread>([this]()
+    _calcThread = std::thread([this]()
     {
         _decreaseThreadPriorityCallback();
         try
@@ -27,26 +61,54 @@ void CDoubleBuffersRandomSequenceGenerator::InitBase()
             Init();
             ProcessEvents();
         }
-        catch (std::runtime_error err)
+        catch (const std::exception& err)
         {
-            std::string str = err.what();
-            std::cerr << "OpenCL error: " << str << std::endl;
-            assert(false);
+            ProducerFailed(err.what());
         }
         catch (...)
         {
+            ProducerFailed("Unknown error");
         }
-        _finishThreadEventHappened = true;
-        _finishThreadCondVar.notify_one();
 
+        // Resources of the backend are released on the thread that has created them
+        try
+        {
+            FinishThread();
+        }
+        catch (...)
+        {
+        }
     });
+}
 
-    _calcThread->detach();
+void CDoubleBuffersRandomSequenceGenerator::StopThread() noexcept
+{
+    if (!_calcThread.joinable())
+        return;
+
+    // Producer leaves the buffer it fills at the next chunk
+    _terminate = true;
+    DoAction(TERMINATE_THREAD);
+    _calcThread.join();
 }
 
 void CDoubleBuffersRandomSequenceGenerator::SetStatistics(const SStatistics& statistics) noexcept
 {
-    _lastStatistics = statistics;
+    _fillStatistics._generate += statistics._generate;
+    _fillStatistics._store += statistics._store;
+}
+
+void CDoubleBuffersRandomSequenceGenerator::PublishStatistics() noexcept
+{
+    SStatistics stat = _fillStatistics;
+    stat._bufSize = BufferSize();
+    stat._buffers = _buffersAmount;
+    stat._consumptionRate = _consumptionRate;
+    stat._failedOver = _failedOver;
+    stat._failoverLatency = _failoverLatency;
+    _lastStatistics = stat;
+
+    _fillStatistics = SStatistics{};
 }
 
 CRandomSequenceGenerator::SStatistics CDoubleBuffersRandomSequenceGenerator::Statistics() const noexcept
@@ -54,68 +116,86 @@ CRandomSequenceGenerator::SStatistics CDoubleBuffersRandomSequenceGenerator::Sta
     return _lastStatistics;
 }
 
-void CDoubleBuffersRandomSequenceGenerator::StartThreadFinish()
+void CDoubleBuffersRandomSequenceGenerator::Init()
 {
-    _finishThreadEventHappened = false;
-    DoAction(TERMINATE_THREAD);
-
-    if (!_finishThreadEventHappened)
+    std::string failure;
+    try
+    {
+        if (!ImplInit())
+            failure = "Backend initialization has failed";
+    }
+    catch (const std::exception& err)
     {
-        std::unique_lock lock(_doActionMutex);
-        constexpr std::chrono::milliseconds waitForFinishing{ 1000 };
-        _finishThreadCondVar.wait_for(lock, waitForFinishing, [this] {return _finishThreadEventHappened; });
-        if (!_finishThreadEventHappened)
-            _calcThread.reset();
+        failure = err.what();
     }
 
-}
+    if (!failure.empty())
+        FailOver(failure);
 
-void CDoubleBuffersRandomSequenceGenerator::Init()
-{
-    ImplInit();
+    _rateTimePoint = TClock::now();
 
-    for (size_t i = 0; i < _buffer.size(); ++i)
+    for (size_t i = 0; i < _buffersAmount; ++i)
     {
-        SBuffer& buffer = _buffer[i];
-        const bool bufferFilled = FillBuffer(i);
-
-        if (!bufferFilled)
+        const size_t consumed = i == 0 && _startPosition ? _startPosition->_consumed : 0;
+        if (!FillCheckedBuffer(i, consumed))
             return;
-
-        buffer._ready = true;
     }
 }
 
 void CDoubleBuffersRandomSequenceGenerator::ProcessEvents()
 {
-    while (true)
+    while (!_terminate)
     {
+        ServeQueuedRequests();
+
+        // Request queued while the others were served waits for the producer with all the buffers ready, nothing else wakes it up
+        if (AsyncRequestsPending() && AllBuffersReady())
+            continue;
+
+        bool eventHappened = true;
         {
+            // Event is consumed after the wake up, serving the requests may switch the buffers and ask for a refill
             std::unique_lock lock(_doActionMutex);
+            if (_buffersAmount > _buffering._minBuffers)
+                eventHappened = _doActionCondVar.wait_for(lock, _shrinkDelay, [this] {return _doActionEventHappened; });
+            else
+                _doActionCondVar.wait(lock, [this] {return _doActionEventHappened; });
             _doActionEventHappened = false;
-            _doActionCondVar.wait(lock, [this] {return _doActionEventHappened; });
+        }
+
+        // Grown ring is shrunk back even when the consumers have gone idle
+        if (!eventHappened)
+        {
+            AdaptBuffersAmount();
+            continue;
         }
 
         switch (_actionToDo)
         {
         case TERMINATE_THREAD:
-            FinishThread();
             return;
 
         case FILL_BUFFER:
-            for (size_t i = 0; i < _buffer.size(); ++i)
+        {
+            // Ring of the seeded generator isn't resized, the buffers added or removed in the middle of the ring
+            // would reorder the sequence depending on the timing
+            if (!_startPosition)
+                AdaptBuffersAmount();
+
+            // Buffers are refilled in the order the consumers go through them starting from the active one
+            const size_t buffersAmount = _buffersAmount;
+            size_t bufferNum = _activeBuffer;
+            for (size_t i = 0; i < buffersAmount; ++i, bufferNum = _buffer[bufferNum]._next)
             {
-                SBuffer& buffer = _buffer[i];
-                if (!buffer._ready)
+                if (!_buffer[bufferNum]._ready && !_terminate)
                 {
-                    if (FillBuffer(i))
-                    {
-                        buffer._consumed = 0;
-                        buffer._ready = true;
-                    }
+                    const TClock::time_point startTimePoint = TClock::now();
+                    if (FillCheckedBuffer(bufferNum))
+                        _fillDuration = TClock::now() - startTimePoint;
                 }
             }
             break;
+        }
 
         default:
             assert(false);
@@ -123,19 +203,374 @@ void CDoubleBuffersRandomSequenceGenerator::ProcessEvents()
     }
 }
 
+bool CDoubleBuffersRandomSequenceGenerator::FillCheckedBuffer(size_t bufferNum, size_t consumed)
+{
+    // Consumers don't touch the buffer until its first chunk is published
+    SBuffer& buffer = _buffer[bufferNum];
+    buffer._consumed = consumed;
+    buffer._lowWaterMarkReached = false;
+
+    if (_startPosition && !_failoverEngine)
+        buffer._engineState = EngineState();
+
+    if (!_healthTests)
+    {
+        if (!FillChunks(bufferNum, true))
+            return false;
+
+        PublishStatistics();
+        return true;
+    }
+
+    for (size_t attempt = 0; ; ++attempt)
+    {
+        // Backend producing the broken output is replaced like the failed one
+        if (attempt == _healthTestAttempts)
+        {
+            using namespace std::string_literals;
+            FailOver("Health tests have failed "s + std::to_string(_healthTestAttempts) + " times in a row"s);
+            attempt = 0;
+        }
+
+        if (attempt > 0 && _startPosition && !_failoverEngine)
+            buffer._engineState = EngineState();
+
+        // Broken output is never published, the checked buffer is published at once
+        if (!FillChunks(bufferNum, false))
+            return false;
+
+        const auto startTimePoint = std::chrono::steady_clock::now();
+        const std::optional<EHealthTest> failedTest = _healthTests->Check(Array(bufferNum), BufferSize());
+        const auto endTimePoint = std::chrono::steady_clock::now();
+
+        _fillStatistics._healthTest = std::chrono::duration_cast<SStatistics::TTimeMeasurement>(endTimePoint - startTimePoint);
+
+        if (!failedTest)
+        {
+            buffer._ready = true;
+            Publish(buffer, BufferSize());
+            PublishStatistics();
+            return true;
+        }
+
+        _healthTestFailedCallback(*failedTest);
+    }
+}
+
+bool CDoubleBuffersRandomSequenceGenerator::FillChunks(size_t bufferNum, bool publish)
+{
+    SBuffer& buffer = _buffer[bufferNum];
+
+    for (size_t offset = 0; offset < BufferSize(); )
+    {
+        if (_terminate)
+            return false;
+
+        // CPU engine publishes the rest of the buffer of the failed backend chunk by chunk
+        const size_t chunkSize = std::min(_failoverEngine ? _publishedChunkSize : ChunkSize(), BufferSize());
+        const size_t size = std::min(chunkSize, BufferSize() - offset);
+        if (!FillPart(bufferNum, offset, size))
+            continue;
+
+        offset += size;
+        if (!publish)
+            continue;
+
+        // Ready is set before the last watermark, the consumer waiting for the whole buffer sees both
+        if (offset == BufferSize())
+            buffer._ready = true;
+
+        Publish(buffer, offset);
+    }
+
+    return true;
+}
+
+// Returns false when the backend has failed, the chunk is filled by the CPU engine on the next call then
+bool CDoubleBuffersRandomSequenceGenerator::FillPart(size_t bufferNum, size_t offset, size_t size)
+{
+    if (_failoverEngine)
+    {
+        const auto startTimePoint = std::chrono::steady_clock::now();
+        FillRandomBytes(*_failoverEngine, Array(bufferNum) + offset, size);
+        const auto endTimePoint = std::chrono::steady_clock::now();
+
+        SStatistics stat;
+        stat._generate = std::chrono::duration_cast<SStatistics::TTimeMeasurement>(endTimePoint - startTimePoint);
+        stat._store = SStatistics::TTimeMeasurement{ 0 };
+        SetStatistics(stat);
+        return true;
+    }
+
+    std::string failure;
+    try
+    {
+        if (FillBuffer(bufferNum, offset, size))
+            return true;
+
+        failure = "Backend has failed to fill the buffer";
+    }
+    catch (const std::exception& err)
+    {
+        failure = err.what();
+    }
+
+    FailOver(failure);
+    return false;
+}
+
+// Same producer thread goes on with the CPU engine over the same ring, the consumers keep waiting for the same watermarks
+void CDoubleBuffersRandomSequenceGenerator::FailOver(const std::string& reason)
+{
+    if (_failoverEngine || !FailoverAllowed())
+        throw std::runtime_error(reason);
+
+    std::cerr << "Random sequence producer has failed, CPU generator takes over: " << reason << std::endl;
+
+    _failureTimePoint = TClock::now();
+    _failoverEngine = std::make_unique<CMtXorLceEngine>();
+    _failoverEngine->seed(static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+    _failedOver = true;
+}
+
+// Every watermark is moved to the failed one, so the consumers waiting for any of them wake up and throw
+void CDoubleBuffersRandomSequenceGenerator::ProducerFailed(const std::string& reason) noexcept
+{
+    std::cerr << "Random sequence producer has failed: " << reason << std::endl;
+
+    _producerFailed = true;
+    for (SBuffer& buffer : _buffer)
+    {
+        buffer._published.store(_failedWatermark, std::memory_order_release);
+        buffer._published.notify_all();
+    }
+
+    {
+        std::lock_guard lock(_readyMutex);
+    }
+    _readyCondVar.notify_all();
+}
+
+void CDoubleBuffersRandomSequenceGenerator::Publish(SBuffer& buffer, size_t bytes) noexcept
+{
+    if (_failoverEngine && !_failoverPublished)
+    {
+        _failoverPublished = true;
+        _failoverLatency = std::chrono::duration_cast<SStatistics::TTimeMeasurement>(TClock::now() - _failureTimePoint);
+    }
+
+    buffer._published.store(bytes, std::memory_order_release);
+    buffer._published.notify_all();
+
+    if (!_readyAnnounced)
+    {
+        _readyAnnounced = true;
+        {
+            std::lock_guard lock(_readyMutex);
+        }
+        _readyCondVar.notify_all();
+    }
+}
+
+/* static */ void CDoubleBuffersRandomSequenceGenerator::WaitForPublished(const SBuffer& buffer, size_t bytes)
+{
+    size_t published;
+    while ((published = buffer._published.load(std::memory_order_acquire)) < bytes)
+        buffer._published.wait(published, std::memory_order_acquire);
+
+    if (published == _failedWatermark)
+        throw std::runtime_error("Random sequence producer has failed");
+}
+
+/* static */ size_t CDoubleBuffersRandomSequenceGenerator::Published(const SBuffer& buffer)
+{
+    const size_t published = buffer._published.load(std::memory_order_acquire);
+    if (published == _failedWatermark)
+        throw std::runtime_error("Random sequence producer has failed");
+
+    return published;
+}
+
+void CDoubleBuffersRandomSequenceGenerator::AdaptBuffersAmount()
+{
+    const TClock::time_point now = TClock::now();
+
+    // Rate is measured over the windows long enough to smooth the single requests out
+    constexpr std::chrono::milliseconds rateWindow{ 10 };
+    if (now - _rateTimePoint >= rateWindow)
+    {
+        const size_t consumedBytes = _consumedBytes.load(std::memory_order_relaxed);
+        const double rate = (consumedBytes - _rateConsumedBytes) / std::chrono::duration<double>(now - _rateTimePoint).count();
+        _consumptionRate = (_consumptionRate + rate) / 2;
+        _rateTimePoint = now;
+        _rateConsumedBytes = consumedBytes;
+    }
+
+    // Active buffer plus the buffers the consumers go through while a single buffer is being refilled
+    const double buffersPerFill = _consumptionRate * std::chrono::duration<double>(_fillDuration).count() / BufferSize();
+    size_t neededBuffers = 1 + static_cast<size_t>(std::ceil(buffersPerFill));
+
+    const size_t buffersAmount = _buffersAmount;
+    const bool consumerWaited = _consumerWaited.load();
+    if (consumerWaited)
+        neededBuffers = std::max(neededBuffers, buffersAmount + 1);
+
+    const size_t targetBuffers = std::clamp(neededBuffers, _buffering._minBuffers, _buffering._maxBuffers);
+
+    if (targetBuffers > buffersAmount)
+    {
+        if (ResizeRing(targetBuffers))
+            _consumerWaited = false;
+        _shrinkRequested = false;
+    }
+    else if (targetBuffers < buffersAmount)
+    {
+        if (!_shrinkRequested)
+        {
+            _shrinkRequested = true;
+            _shrinkRequestedSince = now;
+        }
+        else if (now - _shrinkRequestedSince >= _shrinkDelay && ResizeRing(buffersAmount - 1))
+        {
+            _shrinkRequestedSince = now;
+        }
+    }
+    else
+    {
+        _consumerWaited = false;
+        _shrinkRequested = false;
+    }
+}
+
+bool CDoubleBuffersRandomSequenceGenerator::ResizeRing(size_t buffers)
+{
+    const size_t buffersAmount = _buffersAmount;
+
+    // Added buffers are linked in right after the buffer being refilled, so they are filled next and the consumers never
+    // switch to them while the ready buffers wait behind. With all the buffers ready they go after the last one
+    if (buffers > buffersAmount)
+    {
+        AllocBuffers(buffers, BufferSize());
+
+        size_t insertAfter = _activeBuffer;
+        do
+            insertAfter = _buffer[insertAfter]._next;
+        while (_buffer[insertAfter]._ready && _buffer[insertAfter]._next != _activeBuffer);
+
+        for (size_t i = buffersAmount; i < buffers; ++i)
+        {
+            SBuffer& buffer = _buffer[i];
+            buffer._consumed = 0;
+            buffer._lowWaterMarkReached = false;
+            buffer._published = 0;
+            buffer._buffer = Array(i);
+            buffer._next = i + 1 < buffers ? i + 1 : _buffer[insertAfter]._next.load();
+        }
+
+        // Consumer passing the link sees the initialized buffers behind it
+        _buffer[insertAfter]._next.store(buffersAmount, std::memory_order_release);
+        _buffersAmount = buffers;
+        return true;
+    }
+
+    // Consumer waiting for the refill holds the lock, the ring is shrunk on one of the next wake ups then
+    std::unique_lock lockRndNumberGetter(_getRandomNumberMutex, std::try_to_lock);
+    if (!lockRndNumberGetter.owns_lock())
+        return false;
+
+    // Active buffer is never taken away from the consumers
+    if (_activeBuffer >= buffers)
+        return false;
+
+    _buffersAmount = buffers;
+
+    // Removed buffers are unlinked one by one, the ring stays closed after every step
+    for (size_t i = buffers; i < buffersAmount; ++i)
+    {
+        size_t previous = _activeBuffer;
+        while (_buffer[previous]._next != i)
+            previous = _buffer[previous]._next;
+        _buffer[previous]._next = _buffer[i]._next.load();
+
+        _buffer[i]._published = 0;
+        _buffer[i]._ready = false;
+        _buffer[i]._buffer = nullptr;
+    }
+
+    AllocBuffers(buffers, BufferSize());
+    return true;
+}
+
+void CDoubleBuffersRandomSequenceGenerator::SwitchedFrom(SBuffer& buffer) noexcept
+{
+    _consumedBytes.fetch_add(buffer._consumed, std::memory_order_relaxed);
+}
+
+// Next buffer not filled by the mark makes the consumer wait at the switch, the ring is grown ahead of the wait then
+void CDoubleBuffersRandomSequenceGenerator::CheckLowWaterMark(SBuffer& buffer) noexcept
+{
+    if (buffer._lowWaterMarkReached || BufferSize() - buffer._consumed >= _lowWaterMarkBytes)
+        return;
+
+    buffer._lowWaterMarkReached = true;
+    if (_buffer[buffer._next]._published.load(std::memory_order_acquire) < BufferSize())
+        _consumerWaited = true;
+
+    DoAction(FILL_BUFFER);
+}
+
+bool CDoubleBuffersRandomSequenceGenerator::AllBuffersReady() const noexcept
+{
+    for (size_t i = 0; i < _buffersAmount; ++i)
+        if (!_buffer[i]._ready)
+            return false;
+
+    return true;
+}
+
+// Request that has lost the consumers lock is queued with all the buffers ready, no buffer switch may come to wake the producer
+void CDoubleBuffersRandomSequenceGenerator::AsyncRequestQueued()
+{
+    DoAction(FILL_BUFFER);
+}
+
+void CDoubleBuffersRandomSequenceGenerator::ServeQueuedRequests()
+{
+    // With all the buffers ready the request may only fail on the consumers lock, no refill would wake the thread up
+    while (!ServeAsyncRequests() && AllBuffersReady() && !_terminate)
+        std::this_thread::yield();
+}
+
 bool CDoubleBuffersRandomSequenceGenerator::ReadyToWork() const noexcept
 {
-    for (const SBuffer& buffer : _buffer)
-        if (buffer._ready)
+    if (_producerFailed)
+        return false;
+
+    for (size_t i = 0; i < _buffersAmount; ++i)
+        if (_buffer[i]._published.load(std::memory_order_acquire) > 0)
             return true;
 
     return false;
 }
 
+bool CDoubleBuffersRandomSequenceGenerator::WaitUntilReady(std::chrono::milliseconds timeout)
+{
+    std::unique_lock lock(_readyMutex);
+    const bool ready = _readyCondVar.wait_for(lock, timeout, [this] { return ReadyToWork() || _producerFailed; });
+    if (_producerFailed)
+        throw std::runtime_error("Random sequence producer has failed");
+
+    return ready;
+}
+
 void CDoubleBuffersRandomSequenceGenerator::DoAction(EActionToDo actionToDo) noexcept
 {
-    _actionToDo = actionToDo;
-    _doActionEventHappened = true;
+    // Event is set under the lock, the producer between its check and the wait would miss the notification otherwise
+    {
+        std::lock_guard lock(_doActionMutex);
+        _actionToDo = actionToDo;
+        _doActionEventHappened = true;
+    }
     _doActionCondVar.notify_one();
 }
 
@@ -153,33 +588,41 @@ CRandomSequenceGenerator::TSpan CDoubleBuffersRandomSequenceGenerator::GetRandom
         return TSpan();
     }
 
-    std::lock_guard<std::recursive_mutex> lockRndNumberGetter(_getRandomNumberMutex);
+    std::lock_guard lockRndNumberGetter(_getRandomNumberMutex);
+
+    // Requests made before the first chunk is published wait for it instead of skipping the buffer
+    WaitForPublished(_buffer[_activeBuffer], 1);
 
     const size_t prevConsumed = _buffer[_activeBuffer]._consumed;
     const size_t newConsumed = prevConsumed + size;
 
     TByte* data = nullptr;
 
-    if (newConsumed < BufferSize() && _buffer[_activeBuffer]._ready)
+    if (newConsumed < BufferSize())
     {
+        WaitForPublished(_buffer[_activeBuffer], newConsumed);
         data = _buffer[_activeBuffer]._buffer + prevConsumed;
         _buffer[_activeBuffer]._consumed += size;
+        CheckLowWaterMark(_buffer[_activeBuffer]);
     }
     else
     {
+        // Buffer still being filled is never handed back to the producer
+        WaitForPublished(_buffer[_activeBuffer], BufferSize());
+        // Producer refills the buffer once it isn't ready, the reset watermark must not land over the new one then
+        _buffer[_activeBuffer]._published = 0;
         _buffer[_activeBuffer]._ready = false;
+        SwitchedFrom(_buffer[_activeBuffer]);
 
         DoAction(FILL_BUFFER);
 
-        if (++_activeBuffer >= _buffersAmount)
-            _activeBuffer = 0;
+        _activeBuffer = _buffer[_activeBuffer]._next.load(std::memory_order_acquire);
 
         SBuffer& currentBuffer = _buffer[_activeBuffer];
-        while (!currentBuffer._ready)
-        {
-            constexpr std::chrono::milliseconds waitForFilling{ 10 };
-            std::this_thread::sleep_for(waitForFilling);
-        }
+        if (!currentBuffer._ready)
+            _consumerWaited = true;
+
+        WaitForPublished(currentBuffer, size);
         data = currentBuffer._buffer;
         currentBuffer._consumed = size;
     }
@@ -187,7 +630,134 @@ CRandomSequenceGenerator::TSpan CDoubleBuffersRandomSequenceGenerator::GetRandom
     return TSpan(data, size);
 }
 
+CRandomSequenceGenerator::TSpan CDoubleBuffersRandomSequenceGenerator::TryGetRandomBytes(size_t size)
+{
+    if (size > BufferSize())
+    {
+        using namespace std::string_literals;
+        throw std::length_error("Requested size "s + std::to_string(size) + " is bigger that the buffer size "s + std::to_string(BufferSize()));
+    }
+
+    if (size == 0)
+    {
+        assert(false);
+        return TSpan();
+    }
+
+    std::unique_lock lockRndNumberGetter(_getRandomNumberMutex, std::try_to_lock);
+    if (!lockRndNumberGetter.owns_lock())
+        return TSpan();
+
+    SBuffer& activeBuffer = _buffer[_activeBuffer];
+    const size_t published = Published(activeBuffer);
+
+    if (activeBuffer._consumed + size < BufferSize())
+    {
+        if (activeBuffer._consumed + size > published)
+            return TSpan();
+
+        TByte* data = activeBuffer._buffer + activeBuffer._consumed;
+        activeBuffer._consumed += size;
+        CheckLowWaterMark(activeBuffer);
+        return TSpan(data, size);
+    }
+
+    const size_t nextBufferNum = _buffer[_activeBuffer]._next.load(std::memory_order_acquire);
+    SBuffer& nextBuffer = _buffer[nextBufferNum];
+    if (published < BufferSize() || Published(nextBuffer) < size)
+        return TSpan();
+
+    activeBuffer._published = 0;
+    activeBuffer._ready = false;
+    SwitchedFrom(activeBuffer);
+    DoAction(FILL_BUFFER);
+
+    _activeBuffer = nextBufferNum;
+    nextBuffer._consumed = size;
+    return TSpan(nextBuffer._buffer, size);
+}
+
+// Request reaching the end of the buffer is served from the next one, so the last byte is never left
+size_t CDoubleBuffersRandomSequenceGenerator::ActiveBufferBytesLeft() noexcept
+{
+    std::lock_guard lockRndNumberGetter(_getRandomNumberMutex);
+
+    const size_t consumed = _buffer[_activeBuffer]._consumed;
+    return consumed + 1 < BufferSize() ? BufferSize() - consumed - 1 : 0;
+}
+
 size_t CDoubleBuffersRandomSequenceGenerator::BuffersAmount() const noexcept
 {
     return _buffersAmount;
 }
+
+template<typename TValue>
+static void AppendToSnapshot(CRandomSequenceGenerator::TSnapshot& snapshot, const TValue& value)
+{
+    const size_t offset = snapshot.size();
+    snapshot.resize(offset + sizeof(TValue));
+    std::memcpy(snapshot.data() + offset, &value, sizeof(TValue));
+}
+
+template<typename TValue>
+static TValue ReadFromSnapshot(const CRandomSequenceGenerator::TSnapshot& snapshot, size_t& offset)
+{
+    if (snapshot.size() - offset < sizeof(TValue))
+        throw std::runtime_error("Snapshot is truncated");
+
+    TValue value;
+    std::memcpy(&value, snapshot.data() + offset, sizeof(TValue));
+    offset += sizeof(TValue);
+    return value;
+}
+
+CRandomSequenceGenerator::TSnapshot CDoubleBuffersRandomSequenceGenerator::Snapshot()
+{
+    if (!_startPosition)
+        throw std::runtime_error("Snapshot is available for the explicitly seeded generator only");
+
+    if (_failedOver)
+        throw std::runtime_error("Sequence isn't reproducible after the failover to the CPU engine");
+
+    std::lock_guard lockRndNumberGetter(_getRandomNumberMutex);
+
+    // Engine state is taken before the first chunk is published, it stays in place while the lock is held
+    const SBuffer& activeBuffer = _buffer[_activeBuffer];
+    WaitForPublished(activeBuffer, 1);
+
+    TSnapshot snapshot;
+    AppendToSnapshot(snapshot, _snapshotMagic);
+    AppendToSnapshot(snapshot, _snapshotVersion);
+    AppendToSnapshot(snapshot, static_cast<uint32_t>(GeneratorType()));
+    AppendToSnapshot(snapshot, static_cast<uint64_t>(BufferSize()));
+    AppendToSnapshot(snapshot, _startPosition->_seed);
+    AppendToSnapshot(snapshot, static_cast<uint64_t>(activeBuffer._consumed));
+    AppendToSnapshot(snapshot, static_cast<uint64_t>(activeBuffer._engineState.size()));
+    snapshot.insert(snapshot.end(), activeBuffer._engineState.begin(), activeBuffer._engineState.end());
+
+    return snapshot;
+}
+
+/* static */ CDoubleBuffersRandomSequenceGenerator::SSnapshot CDoubleBuffersRandomSequenceGenerator::ParseSnapshot(const TSnapshot& snapshot)
+{
+    size_t offset = 0;
+    if (ReadFromSnapshot<std::remove_cv_t<decltype(_snapshotMagic)>>(snapshot, offset) != _snapshotMagic || ReadFromSnapshot<uint32_t>(snapshot, offset) != _snapshotVersion)
+        throw std::runtime_error("Snapshot has unknown format");
+
+    SSnapshot parsed;
+    const uint32_t generatorType = ReadFromSnapshot<uint32_t>(snapshot, offset);
+    if (generatorType > CHACHA20_GENERATOR || generatorType == GPU_IF_POSSIBLE_GENERATOR)
+        throw std::runtime_error("Snapshot has unknown generator type");
+
+    parsed._generatorType = static_cast<EGeneratorType>(generatorType);
+    parsed._bufferSize = static_cast<size_t>(ReadFromSnapshot<uint64_t>(snapshot, offset));
+    parsed._position._seed = ReadFromSnapshot<uint64_t>(snapshot, offset);
+    parsed._position._consumed = static_cast<size_t>(ReadFromSnapshot<uint64_t>(snapshot, offset));
+
+    const uint64_t engineStateSize = ReadFromSnapshot<uint64_t>(snapshot, offset);
+    if (snapshot.size() - offset != engineStateSize)
+        throw std::runtime_error("Snapshot is truncated");
+
+    parsed._position._engineState.assign(snapshot.begin() + offset, snapshot.end());
+    return parsed;
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+    #include <emmintrin.h>
+    #define RANDOM_SEQUENCE_GENERATOR_SSE2
+#endif // defined(_M_X64) || defined(__SSE2__)
+
+#include "healthTests.hpp"
+
+std::optional<CHealthTests::EHealthTest> CHealthTests::Check(const TByte* data, size_t size) noexcept
+{
+    if (!RepetitionCountTest(data, size))
+        return CRandomSequenceGenerator::REPETITION_COUNT_TEST;
+
+    if (!AdaptiveProportionTest(data, size))
+        return CRandomSequenceGenerator::ADAPTIVE_PROPORTION_TEST;
+
+    if (!DuplicateBufferTest(data, size))
+        return CRandomSequenceGenerator::DUPLICATE_BUFFER_TEST;
+
+    return std::nullopt;
+}
+
+/* static */ bool CHealthTests::RepetitionCountTest(const TByte* data, size_t size) noexcept
+{
+    // Run of the cutoff identical samples is the run of cutoff - 1 equal neighbour pairs
+    constexpr size_t equalPairsCutoff = _repetitionCountCutoff - 1;
+    static_assert(equalPairsCutoff == 8, "Pairs run detection below is built for 8 pairs");
+    constexpr size_t carryBits = equalPairsCutoff - 1;
+
+    size_t i = 0;
+    uint64_t carry = 0;
+
+#ifdef RANDOM_SEQUENCE_GENERATOR_SSE2
+    // Bit per neighbour pair, the previous block tail is carried to find runs crossing the blocks border
+    constexpr size_t step = 2 * sizeof(__m128i);
+    for (; i + step < size; i += step)
+    {
+        const __m128i current0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i next0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        const __m128i current1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + sizeof(__m128i)));
+        const __m128i next1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + sizeof(__m128i) + 1));
+        const uint64_t equalPairs = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current0, next0))) |
+            static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current1, next1)))) << sizeof(__m128i);
+
+        uint64_t runs = equalPairs << carryBits | carry;
+        runs &= runs >> 1;
+        runs &= runs >> 2;
+        runs &= runs >> 4;
+        if (runs)
+            return false;
+
+        carry = equalPairs >> (step - carryBits);
+    }
+#endif // RANDOM_SEQUENCE_GENERATOR_SSE2
+
+    size_t equalPairsRun = std::countl_one(carry << (64 - carryBits));
+    for (; i + 1 < size; ++i)
+    {
+        equalPairsRun = data[i] == data[i + 1] ? equalPairsRun + 1 : 0;
+        if (equalPairsRun >= equalPairsCutoff)
+            return false;
+    }
+
+    return true;
+}
+
+/* static */ bool CHealthTests::AdaptiveProportionTest(const TByte* data, size_t size) noexcept
+{
+    for (size_t window = 0; window + _adaptiveProportionWindow <= size; window += _adaptiveProportionWindow)
+    {
+        const TByte* windowData = data + window;
+        size_t matches = 0;
+
+#ifdef RANDOM_SEQUENCE_GENERATOR_SSE2
+        // Per lane counters can't overflow as every lane sees 32 samples of the window
+        static_assert(_adaptiveProportionWindow / sizeof(__m128i) < 256, "Lane counter overflow");
+        const __m128i first = _mm_set1_epi8(static_cast<char>(windowData[0]));
+        __m128i laneMatches = _mm_setzero_si128();
+        for (size_t i = 0; i < _adaptiveProportionWindow; i += sizeof(__m128i))
+        {
+            const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(windowData + i));
+            laneMatches = _mm_sub_epi8(laneMatches, _mm_cmpeq_epi8(samples, first));
+        }
+        const __m128i sums = _mm_sad_epu8(laneMatches, _mm_setzero_si128());
+        matches = static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+#else // RANDOM_SEQUENCE_GENERATOR_SSE2
+        matches = std::count(windowData, windowData + _adaptiveProportionWindow, windowData[0]);
+#endif // RANDOM_SEQUENCE_GENERATOR_SSE2
+
+        if (matches >= _adaptiveProportionCutoff)
+            return false;
+    }
+
+    return true;
+}
+
+/* static */ uint64_t CHealthTests::Fingerprint(const TByte* data, size_t size) noexcept
+{
+    uint64_t fingerprint = 0xcbf29ce484222325ULL ^ size;
+    if (size < sizeof(uint64_t))
+    {
+        for (size_t i = 0; i < size; ++i)
+            fingerprint = (fingerprint ^ data[i]) * 0x100000001b3ULL;
+        return fingerprint;
+    }
+
+    // Words sampled over the whole buffer are enough to recognize a stale or repeated buffer
+    const size_t stride = std::max<size_t>((size - sizeof(uint64_t)) / (_fingerprintWords - 1), 1);
+    for (size_t offset = 0; offset + sizeof(uint64_t) <= size; offset += stride)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(word));
+        fingerprint = (fingerprint ^ word) * 0x9e3779b97f4a7c15ULL;
+        fingerprint ^= fingerprint >> 29;
+    }
+
+    return fingerprint;
+}
+
+bool CHealthTests::DuplicateBufferTest(const TByte* data, size_t size) noexcept
+{
+    const uint64_t fingerprint = Fingerprint(data, size);
+    const size_t historySize = std::min(_fingerprintsAmount, _fingerprintHistory);
+
+    for (size_t i = 0; i < historySize; ++i)
+        if (_fingerprints[i] == fingerprint)
+            return false;
+
+    _fingerprints[_fingerprintsAmount++ % _fingerprintHistory] = fingerprint;
+
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_HEALTH_TESTS_
+#define RANDOM_SEQUENCE_GENERATOR_HEALTH_TESTS_
+
+#include <array>
+#include <optional>
+
+#include "include/randomSequenceGenerator.hpp"
+
+// Online health tests in the SP 800-90B style for byte samples claimed to have full entropy.
+// Cutoffs use false positive probability 2^-64 per sample instead of 2^-20..2^-40 because the
+// tests run over whole buffers of hundreds of megabytes
+class CHealthTests
+{
+public:
+    using EHealthTest = CRandomSequenceGenerator::EHealthTest;
+    using TByte = CRandomSequenceGenerator::TByte;
+
+    std::optional<EHealthTest> Check(const TByte* data, size_t size) noexcept;
+
+private:
+    // 1 + ceil(64 / 8) identical samples in a row
+    static constexpr size_t _repetitionCountCutoff = 9;
+    // 1 + Binomial(511, 1/256) >= 27 happens with probability below 2^-64
+    static constexpr size_t _adaptiveProportionWindow = 512;
+    static constexpr size_t _adaptiveProportionCutoff = 27;
+    static constexpr size_t _fingerprintWords = 64;
+    static constexpr size_t _fingerprintHistory = 8;
+
+    std::array<uint64_t, _fingerprintHistory> _fingerprints{};
+    size_t _fingerprintsAmount = 0;
+
+    static bool RepetitionCountTest(const TByte* data, size_t size) noexcept;
+    static bool AdaptiveProportionTest(const TByte* data, size_t size) noexcept;
+    static uint64_t Fingerprint(const TByte* data, size_t size) noexcept;
+    bool DuplicateBufferTest(const TByte* data, size_t size) noexcept;
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_HEALTH_TESTS_
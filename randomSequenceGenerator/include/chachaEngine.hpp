@@ -0,0 +1,50 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_CHACHA_ENGINE_
+#define RANDOM_SEQUENCE_GENERATOR_CHACHA_ENGINE_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ChaCha keystream generator used as the DRBG : every Generate call is followed by the fast key erasure,
+// the key is replaced by the first half of the next keystream block, so the produced bytes can't be recovered
+// from the engine state later. Blocks are computed by the widest kernel the CPU supports
+class CChaChaEngine
+{
+public:
+    using TKey = std::array<uint8_t, 32>;
+
+    explicit CChaChaEngine(size_t rounds);
+    ~CChaChaEngine() noexcept;
+
+    CChaChaEngine(const CChaChaEngine&) = delete;
+    CChaChaEngine& operator=(const CChaChaEngine&) = delete;
+
+    // Key is XORed with the new one, the entropy of the old key is never lost
+    void Seed(const TKey& key) noexcept;
+    void Generate(uint8_t* data, size_t size) noexcept;
+
+    // Key is the whole state between the Generate calls
+    TKey Key() const noexcept;
+    void SetKey(const TKey& key) noexcept;
+
+    static void OSRandomBytes(uint8_t* data, size_t size);
+    // Original ChaCha state layout : constants, key, 64-bit block counter in the words 12 and 13, 64-bit nonce
+    static void KeystreamBlocks(const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept;
+
+    // Kernels the CPU supports, every one of them must produce the keystream of the scalar kernel
+    enum EKernel { SCALAR_KERNEL, SSE2_KERNEL, AVX2_KERNEL, AVX512_KERNEL };
+    static std::vector<EKernel> SupportedKernels();
+    // Blocks left by the wide kernel are finished by the scalar one
+    static void KernelBlocks(EKernel kernel, const uint32_t* state, uint64_t counter, size_t rounds, uint8_t* data, size_t blocks) noexcept;
+
+private:
+    static constexpr size_t _blockSize = 64;
+    static constexpr size_t _keyWord = 4;
+    static constexpr size_t _keyWords = 8;
+
+    std::array<uint32_t, 16> _state;
+    const size_t _rounds;
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_CHACHA_ENGINE_
@@ -0,0 +1,205 @@
+
+#ifndef RANDOM_SEQUENCE_GENERATOR_DOUBLE_BUFFERS_IMPLEMENTATION_
+#define RANDOM_SEQUENCE_GENERATOR_DOUBLE_BUFFERS_IMPLEMENTATION_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "randomSequenceGenerator.hpp"
+
+class CHealthTests;
+class CMtXorLceEngine;
+
+// Ring of the buffers refilled by the producer thread, the backends fill the buffers
+class CDoubleBuffersRandomSequenceGenerator : public CRandomSequenceGenerator
+{
+public:
+    // Engine state is empty for the sequence started from the seed, the consumed bytes are skipped in the first buffer
+    struct SStreamPosition
+    {
+        uint64_t _seed;
+        TBuffer _engineState;
+        size_t _consumed = 0;
+    };
+
+    struct SSnapshot
+    {
+        EGeneratorType _generatorType;
+        size_t _bufferSize;
+        SStreamPosition _position;
+    };
+
+    CDoubleBuffersRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering, const std::optional<SStreamPosition>& startPosition, bool singleConsumer = false);
+    ~CDoubleBuffersRandomSequenceGenerator() noexcept override;
+
+    bool ReadyToWork() const noexcept override;
+    bool WaitUntilReady(std::chrono::milliseconds timeout) override;
+    SStatistics Statistics() const noexcept override;
+    TSnapshot Snapshot() override;
+    bool ConcurrentConsumers() const noexcept override { return !_singleConsumer; }
+
+    static SSnapshot ParseSnapshot(const TSnapshot& snapshot);
+
+protected:
+    enum EActionToDo { FILL_BUFFER, TERMINATE_THREAD };
+    // Called again from the producer thread when the ring is resized, the data of the kept buffers must stay in place
+    virtual void AllocBuffers(size_t buffers, size_t bytesInBuffer) = 0;
+    // Throws or returns false when the backend can't work, the CPU engine takes over the ring then
+    virtual bool ImplInit() = 0;
+    // Called on the producer thread before it exits, also after the failover
+    virtual void FinishThread() {}
+    // Fills the part of the buffer, the buffer is filled chunk by chunk in order and each chunk is published to the consumers at once
+    virtual bool FillBuffer(size_t bufferNum, size_t offset, size_t size) = 0;
+    // Backends filling the whole buffer at once return the buffer size
+    virtual size_t ChunkSize() const noexcept { return _publishedChunkSize; }
+    virtual size_t BuffersAmount() const noexcept;
+    // Backend that must not be replaced by the weaker CPU engine fails the consumers instead
+    virtual bool FailoverAllowed() const noexcept { return true; }
+    virtual TByte* Array(size_t bufferNum) noexcept = 0;
+    // Taken on the producer thread before every fill of the seeded generator, the buffer is regenerated from it on restore
+    virtual TBuffer EngineState() const = 0;
+    virtual EGeneratorType GeneratorType() const noexcept = 0;
+
+    bool AsyncRequestsServed() const noexcept override { return !_singleConsumer; }
+    void AsyncRequestQueued() override;
+
+    void SetStatistics(const SStatistics& statistics) noexcept;
+    void InitBase();
+    // Called first by the destructor of the implementation, the producer thread calls its virtual functions
+    void StopThread() noexcept;
+    const std::optional<SStreamPosition>& StartPosition() const noexcept { return _startPosition; }
+
+    // Request inside the published part of the active buffer short of its low-water mark, the compile time generator serves it
+    // inline without the virtual call. Empty span sends the request to the full consumer path
+    TSpan TakeFromActiveBuffer(size_t size)
+    {
+        std::lock_guard lockRndNumberGetter(_getRandomNumberMutex);
+
+        SBuffer& buffer = _buffer[_activeBuffer.load(std::memory_order_relaxed)];
+        const size_t newConsumed = buffer._consumed + size;
+        if (size == 0 || newConsumed >= BufferSize() || (!buffer._lowWaterMarkReached && BufferSize() - newConsumed < _lowWaterMarkBytes))
+            return TSpan();
+
+        const size_t published = buffer._published.load(std::memory_order_acquire);
+        if (newConsumed > published || published == _failedWatermark)
+            return TSpan();
+
+        TByte* data = buffer._buffer + buffer._consumed;
+        buffer._consumed = newConsumed;
+        return TSpan(data, size);
+    }
+
+private:
+    // Consumers read the buffer up to the published watermark while the producer is still filling the rest,
+    // the buffer is ready once it is filled completely. Consumers go through the ring by the next links, so the grown
+    // ring gets its buffers in the middle of the consumption order
+    struct SBuffer
+    {
+        std::atomic<bool> _ready = false;
+        std::atomic<size_t> _published = 0;
+        std::atomic<size_t> _next = 0;
+        TByte* _buffer = nullptr;
+        size_t _consumed = 0;
+        bool _lowWaterMarkReached = false;
+        TBuffer _engineState;
+    };
+
+    // Consumer path of the single consumer generator takes no lock, its ring is never resized
+    class CConsumerMutex
+    {
+    public:
+        explicit CConsumerMutex(bool singleConsumer) noexcept : _singleConsumer(singleConsumer) {}
+
+        void lock() { if (!_singleConsumer) _mutex.lock(); }
+        bool try_lock() { return _singleConsumer || _mutex.try_lock(); }
+        void unlock() { if (!_singleConsumer) _mutex.unlock(); }
+
+    private:
+        const bool _singleConsumer;
+        std::recursive_mutex _mutex;
+    };
+
+    using TClock = std::chrono::steady_clock;
+
+    static constexpr size_t _maxBuffersAmount = 16;
+    static constexpr size_t _healthTestAttempts = 3;
+    // Multiple of the engine words, the chunked fill produces the same bytes as the whole one
+    static constexpr size_t _publishedChunkSize = 64 * 1024;
+    static constexpr std::array<char, 4> _snapshotMagic = { 'R', 'S', 'G', 'S' };
+    static constexpr uint32_t _snapshotVersion = 1;
+    // Ring is shrunk by one buffer when the consumption has stayed low for the delay, the idle producer wakes up for it
+    static constexpr std::chrono::milliseconds _shrinkDelay{ 1000 };
+    // Watermark of every buffer once the producer has failed without the failover, the waiting consumers throw
+    static constexpr size_t _failedWatermark = std::numeric_limits<size_t>::max();
+    std::thread _calcThread;
+    std::atomic<bool> _terminate = false;
+    std::array<SBuffer, _maxBuffersAmount> _buffer;
+    std::atomic<size_t> _buffersAmount;
+    std::atomic<size_t> _activeBuffer = 0;
+    const SBuffering _buffering;
+    const std::optional<SStreamPosition> _startPosition;
+    const size_t _lowWaterMarkBytes;
+    const bool _singleConsumer;
+    std::atomic<size_t> _consumedBytes = 0;
+    std::atomic<bool> _consumerWaited = false;
+    // Consumption rate and the ring size decisions are made on the producer thread only
+    TClock::time_point _rateTimePoint;
+    size_t _rateConsumedBytes = 0;
+    double _consumptionRate = 0;
+    TClock::duration _fillDuration{ 0 };
+    TClock::time_point _shrinkRequestedSince;
+    bool _shrinkRequested = false;
+    std::atomic<EActionToDo> _actionToDo;
+    CConsumerMutex _getRandomNumberMutex;
+    std::mutex _doActionMutex;
+    std::condition_variable _doActionCondVar;
+    bool _doActionEventHappened = false;
+    FDecreaseThreadPriority _decreaseThreadPriorityCallback;
+    std::atomic<SStatistics> _lastStatistics;
+    // Chunks of the buffer are summed up on the producer thread, the statistics are published per buffer
+    SStatistics _fillStatistics{};
+    std::mutex _readyMutex;
+    std::condition_variable _readyCondVar;
+    bool _readyAnnounced = false;
+    FHealthTestFailed _healthTestFailedCallback;
+    std::unique_ptr<CHealthTests> _healthTests;
+    // Failover engine and its timing are kept on the producer thread, the consumers see them through the statistics
+    std::unique_ptr<CMtXorLceEngine> _failoverEngine;
+    TClock::time_point _failureTimePoint;
+    SStatistics::TTimeMeasurement _failoverLatency{ 0 };
+    bool _failoverPublished = false;
+    std::atomic<bool> _failedOver = false;
+    std::atomic<bool> _producerFailed = false;
+
+    void Init();
+    void ProcessEvents();
+    bool FillCheckedBuffer(size_t bufferNum, size_t consumed = 0);
+    bool FillChunks(size_t bufferNum, bool publish);
+    bool FillPart(size_t bufferNum, size_t offset, size_t size);
+    void FailOver(const std::string& reason);
+    void ProducerFailed(const std::string& reason) noexcept;
+    void Publish(SBuffer& buffer, size_t bytes) noexcept;
+    void PublishStatistics() noexcept;
+    static void WaitForPublished(const SBuffer& buffer, size_t bytes);
+    static size_t Published(const SBuffer& buffer);
+    bool AllBuffersReady() const noexcept;
+    void AdaptBuffersAmount();
+    bool ResizeRing(size_t buffers);
+    void SwitchedFrom(SBuffer& buffer) noexcept;
+    void CheckLowWaterMark(SBuffer& buffer) noexcept;
+    void ServeQueuedRequests();
+    TSpan GetRandomBytes(size_t size) override;
+    TSpan TryGetRandomBytes(size_t size) override;
+    size_t ActiveBufferBytesLeft() noexcept override;
+    void DoAction(EActionToDo actionToDo) noexcept;
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_DOUBLE_BUFFERS_IMPLEMENTATION_
@@ -0,0 +1,45 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_KERNEL_CONFIG_CACHE_
+#define RANDOM_SEQUENCE_GENERATOR_KERNEL_CONFIG_CACHE_
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+// Best GPU kernel variant per device, it is looked for at the first init on the device and kept in the file for the next runs.
+// Line per device : the device key, a tab, the local size, the items per work item and the vector width. The cache is
+// an optimization only, its errors are ignored and the entry that isn't one of the tuned variants is tuned again
+class CKernelConfigCache
+{
+public:
+    struct SKernelConfig
+    {
+        size_t _localSize = 0;      // 0 leaves the work-group size to the driver
+        size_t _itemsPerWorkItem = 1;
+        size_t _vectorWidth = 1;
+
+        bool operator==(const SKernelConfig&) const = default;
+    };
+
+    static constexpr std::array<size_t, 7> _tunedLocalSizes = { 0, 32, 64, 128, 256, 512, 1024 };
+    static constexpr std::array<size_t, 4> _tunedItemsPerWorkItem = { 1, 4, 16, 64 };
+    static constexpr std::array<size_t, 4> _tunedVectorWidths = { 1, 2, 4, 8 };
+
+    // Empty path disables the cache
+    explicit CKernelConfigCache(std::filesystem::path path) : _path(std::move(path)) {}
+
+    // File in the cache directory of the user, the directory is created accessible to the user only.
+    // Empty when the user has no home directory
+    static std::filesystem::path UserCachePath();
+
+    std::optional<SKernelConfig> Load(const std::string& deviceKey) const;
+    void Store(const std::string& deviceKey, const SKernelConfig& config) const;
+
+private:
+    const std::filesystem::path _path;
+
+    static bool Tuned(const SKernelConfig& config) noexcept;
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_KERNEL_CONFIG_CACHE_
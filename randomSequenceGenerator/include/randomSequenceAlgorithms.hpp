@@ -0,0 +1,329 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_ALGORITHMS_
+#define RANDOM_SEQUENCE_GENERATOR_ALGORITHMS_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif // _MSC_VER
+
+#include "randomSequenceGenerator.hpp"
+
+// 64-bit words taken from the generator buffers in batches, the consumers lock is taken once per batch instead of once per draw
+class CRandomWords
+{
+public:
+    // Bounds of the indexes decoded from the single word, their product must fit in it
+    static constexpr size_t _maxBatchedDraws = 6;
+
+    explicit CRandomWords(CRandomSequenceGenerator& generator) :
+        _generator(generator), _batchSize(std::min(generator.BufferSize() / sizeof(uint64_t), _maxBatchSize))
+    {
+        if (_batchSize == 0)
+        {
+            using namespace std::string_literals;
+            throw std::length_error("Buffer size "s + std::to_string(generator.BufferSize()) + " is less than the word size"s);
+        }
+    }
+
+    uint64_t Next()
+    {
+        if (_next == _available) [[unlikely]]
+            Refill();
+
+        return _batch[_next++];
+    }
+
+    // Lemire's multiply-shift, the division is taken on the rare rejection path only
+    uint64_t Below(uint64_t bound)
+    {
+        uint64_t index;
+        uint64_t leftover = MultiplyWide(Next(), bound, index);
+        if (leftover < bound) [[unlikely]]
+        {
+            const uint64_t threshold = (0 - bound) % bound;
+            while (leftover < threshold)
+                leftover = MultiplyWide(Next(), bound, index);
+        }
+
+        return index;
+    }
+
+    // Uniform in (0, 1), never zero so its logarithm is finite
+    double Unit()
+    {
+        return (static_cast<double>(Next() >> 11) + 0.5) * 0x1.0p-53;
+    }
+
+    // Indexes in [0, size), [0, size - 1) ... [0, size - amount + 1) are decoded from the single word (Brackett-Rozinsky, Lemire).
+    // The threshold is computed only when the leftover is below the product bound, the returned exact product bounds
+    // the products of the following smaller batches
+    uint64_t DrawBatch(uint64_t size, size_t amount, uint64_t productBound, std::array<uint64_t, _maxBatchedDraws>& indexes)
+    {
+        uint64_t leftover = DecodeBatch(Next(), size, amount, indexes);
+        if (leftover < productBound) [[unlikely]]
+        {
+            uint64_t product = size;
+            for (size_t draw = 1; draw < amount; ++draw)
+                product *= size - draw;
+
+            const uint64_t threshold = (0 - product) % product;
+            while (leftover < threshold)
+                leftover = DecodeBatch(Next(), size, amount, indexes);
+
+            return product;
+        }
+
+        return productBound;
+    }
+
+    // Returns the low half of the 128-bit product
+    static uint64_t MultiplyWide(uint64_t first, uint64_t second, uint64_t& high) noexcept
+    {
+#ifdef _MSC_VER
+        return _umul128(first, second, &high);
+#else // _MSC_VER
+        const unsigned __int128 product = static_cast<unsigned __int128>(first) * second;
+        high = static_cast<uint64_t>(product >> 64);
+        return static_cast<uint64_t>(product);
+#endif // _MSC_VER
+    }
+
+private:
+    static constexpr size_t _maxBatchSize = 512;
+
+    CRandomSequenceGenerator& _generator;
+    const size_t _batchSize;
+    std::array<uint64_t, _maxBatchSize> _batch;
+    size_t _next = 0;
+    size_t _available = 0;
+
+    void Refill()
+    {
+        // Copied at once, the span is valid only until the other consumers drain the buffer
+        std::span<uint64_t> words = _generator.GetDataSpan<uint64_t>(_batchSize);
+        std::copy(words.begin(), words.end(), _batch.begin());
+        _next = 0;
+        _available = words.size();
+    }
+
+    static uint64_t DecodeBatch(uint64_t word, uint64_t size, size_t amount, std::array<uint64_t, _maxBatchedDraws>& indexes) noexcept
+    {
+        for (size_t draw = 0; draw < amount; ++draw)
+            word = MultiplyWide(word, size - draw, indexes[draw]);
+
+        return word;
+    }
+};
+
+// Fisher-Yates over the last amount positions : they get the uniform random sample of the whole span in random order.
+// Sizes up to 2^30 share the word between several draws, the product of the bounds stays below 2^60
+template<typename TData>
+void PartialShuffle(CRandomWords& words, std::span<TData> data, size_t amount)
+{
+    static constexpr std::array<uint64_t, CRandomWords::_maxBatchedDraws - 1> batchedSizeLimits = { 1ULL << 30, 1ULL << 20, 1ULL << 15, 1ULL << 12, 1ULL << 10 };
+
+    uint64_t size = data.size();
+    const uint64_t end = size - std::min<uint64_t>(amount, size);
+
+    for (; size > std::max<uint64_t>(batchedSizeLimits.front(), end) && size > 1; --size)
+        std::ranges::swap(data[size - 1], data[words.Below(size)]);
+
+    std::array<uint64_t, CRandomWords::_maxBatchedDraws> indexes;
+    for (size_t limit = 0; limit < batchedSizeLimits.size(); ++limit)
+    {
+        const size_t batch = limit + 2;
+        const uint64_t nextLimit = limit + 1 < batchedSizeLimits.size() ? batchedSizeLimits[limit + 1] : 1;
+        uint64_t productBound = 1ULL << 60;
+
+        while (size > std::max(nextLimit, end) && size > 1)
+        {
+            const size_t draws = static_cast<size_t>(std::min<uint64_t>({ batch, size - 1, size - end }));
+            productBound = words.DrawBatch(size, draws, productBound, indexes);
+
+            for (size_t draw = 0; draw < draws; ++draw)
+                std::ranges::swap(data[size - draw - 1], data[indexes[draw]]);
+
+            size -= draws;
+        }
+    }
+}
+
+template<typename TData>
+void Shuffle(CRandomWords& words, std::span<TData> data)
+{
+    PartialShuffle(words, data, data.size());
+}
+
+template<typename TData>
+void Shuffle(CRandomSequenceGenerator& generator, std::span<TData> data)
+{
+    CRandomWords words(generator);
+    Shuffle(words, data);
+}
+
+// Every element is moved to the random bucket, then the buckets are shuffled independently (Sanders). Each thread draws
+// its own words from the generator, the data is copied once. The threads request the generator concurrently, small arrays
+// and the generators without the consumers lock (ConcurrentConsumers is false) are shuffled on the calling thread
+template<typename TData>
+requires std::movable<TData> && std::default_initializable<TData>
+void ParallelShuffle(CRandomSequenceGenerator& generator, std::span<TData> data, size_t threadsAmount = std::thread::hardware_concurrency())
+{
+    static constexpr size_t minThreadElements = 1 << 16;
+    using TBucket = uint16_t;
+
+    threadsAmount = std::min({ threadsAmount, data.size() / minThreadElements, static_cast<size_t>(std::numeric_limits<TBucket>::max()) });
+    if (threadsAmount < 2 || !generator.ConcurrentConsumers())
+    {
+        Shuffle(generator, data);
+        return;
+    }
+
+    std::vector<CRandomWords> words;
+    words.reserve(threadsAmount);
+    for (size_t thread = 0; thread < threadsAmount; ++thread)
+        words.emplace_back(generator);
+
+    const auto runThreads = [threadsAmount](auto&& work)
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(threadsAmount);
+        for (size_t thread = 0; thread < threadsAmount; ++thread)
+            threads.emplace_back(work, thread);
+
+        for (std::thread& thread : threads)
+            thread.join();
+    };
+
+    const size_t chunkSize = (data.size() + threadsAmount - 1) / threadsAmount;
+    const auto chunk = [&data, chunkSize](size_t thread)
+    {
+        const size_t begin = std::min(thread * chunkSize, data.size());
+        return data.subspan(begin, std::min(chunkSize, data.size() - begin));
+    };
+
+    // Offsets of the chunk part inside the bucket, indexed by chunk * threadsAmount + bucket
+    std::vector<TBucket> bucketOf(data.size());
+    std::vector<size_t> offsets(threadsAmount * threadsAmount, 0);
+    runThreads([&](size_t thread)
+    {
+        const size_t begin = thread * chunkSize;
+        const size_t size = chunk(thread).size();
+        std::vector<size_t> counts(threadsAmount, 0);
+        for (size_t i = begin; i < begin + size; ++i)
+        {
+            bucketOf[i] = static_cast<TBucket>(words[thread].Below(threadsAmount));
+            ++counts[bucketOf[i]];
+        }
+
+        std::copy(counts.begin(), counts.end(), offsets.begin() + thread * threadsAmount);
+    });
+
+    std::vector<size_t> bucketBegin(threadsAmount + 1, 0);
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < threadsAmount; ++bucket)
+    {
+        bucketBegin[bucket] = offset;
+        for (size_t thread = 0; thread < threadsAmount; ++thread)
+            offset += std::exchange(offsets[thread * threadsAmount + bucket], offset);
+    }
+    bucketBegin[threadsAmount] = offset;
+
+    std::vector<TData> scattered(data.size());
+    runThreads([&](size_t thread)
+    {
+        const size_t begin = thread * chunkSize;
+        std::span<TData> part = chunk(thread);
+        for (size_t i = 0; i < part.size(); ++i)
+            scattered[offsets[thread * threadsAmount + bucketOf[begin + i]]++] = std::move(part[i]);
+    });
+
+    runThreads([&](size_t bucket)
+    {
+        std::span<TData> bucketData(scattered.data() + bucketBegin[bucket], bucketBegin[bucket + 1] - bucketBegin[bucket]);
+        Shuffle(words[bucket], bucketData);
+        std::move(bucketData.begin(), bucketData.end(), data.begin() + bucketBegin[bucket]);
+    });
+}
+
+// Li's algorithm L : the amount of the skipped items is drawn at once, O(k log(n / k)) draws instead of O(n).
+// Returns the amount of the sampled items, it is less than the reservoir size when the range is shorter
+template<std::input_iterator TIterator, std::sentinel_for<TIterator> TSentinel, typename TData>
+requires std::assignable_from<TData&, std::iter_reference_t<TIterator>>
+size_t ReservoirSample(CRandomSequenceGenerator& generator, TIterator first, TSentinel last, std::span<TData> reservoir)
+{
+    const size_t size = reservoir.size();
+
+    size_t filled = 0;
+    for (; filled < size && first != last; ++first)
+        reservoir[filled++] = *first;
+
+    if (filled < size || first == last)
+        return filled;
+
+    using TDifference = std::iter_difference_t<TIterator>;
+    static constexpr double maxSkip = static_cast<double>(std::numeric_limits<TDifference>::max() / 2);
+
+    CRandomWords words(generator);
+    double weight = std::exp(std::log(words.Unit()) / size);
+    while (true)
+    {
+        const double skip = std::floor(std::log(words.Unit()) / std::log1p(-weight));
+        if (skip >= maxSkip)
+            return size;
+
+        std::ranges::advance(first, static_cast<TDifference>(skip), last);
+        if (first == last)
+            return size;
+
+        reservoir[words.Below(size)] = *first;
+        ++first;
+
+        weight *= std::exp(std::log(words.Unit()) / size);
+    }
+}
+
+// Walker's alias method with Vose's construction. A sample takes a single word : the high half of its product by the categories
+// amount is the column, the low half is compared with the column threshold. Batches are mapped straight from the generator buffer
+class CAliasSampler
+{
+public:
+    explicit CAliasSampler(std::span<const double> weights);
+
+    size_t Size() const noexcept { return _threshold.size(); }
+
+    uint32_t Sample(CRandomSequenceGenerator& generator)
+    {
+        return Lookup(generator.GetValue<uint64_t>());
+    }
+
+    void Sample(CRandomSequenceGenerator& generator, std::span<uint32_t> indexes);
+
+private:
+    std::vector<uint64_t> _threshold;
+    std::vector<uint32_t> _alias;
+
+    uint32_t Lookup(uint64_t word) const noexcept
+    {
+        uint64_t column;
+        const uint64_t fraction = CRandomWords::MultiplyWide(word, _threshold.size(), column);
+        return fraction < _threshold[column] ? static_cast<uint32_t>(column) : _alias[column];
+    }
+};
+
+// Distinct indexes of [0, populationSize) in random order. Large samples are taken by the partial shuffle of all the indexes,
+// small ones by Floyd's algorithm in the sample size memory
+std::vector<uint64_t> SampleIndexes(CRandomSequenceGenerator& generator, uint64_t populationSize, size_t sampleSize);
+
+#endif // RANDOM_SEQUENCE_GENERATOR_ALGORITHMS_
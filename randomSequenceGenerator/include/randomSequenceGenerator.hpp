@@ -2,10 +2,19 @@
 #ifndef RANDOM_SEQUENCE_GENERATOR_INTERFACE_
 #define RANDOM_SEQUENCE_GENERATOR_INTERFACE_
 
+#include <algorithm>
+#include <bit>
+#include <bitset>
 #include <chrono>
+#include <coroutine>
+#include <deque>
+#include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <span>
+#include <string>
 #include <type_traits>
 
 template<typename TContainer>
@@ -14,45 +23,113 @@ concept CoRandomSequenceGeneratorContainer = requires(typename TContainer::value
     TContainer(pdata, pdata);
 };
 
+template<typename TContainer>
+concept CoRandomSequenceGeneratorAllocatorContainer = requires(typename TContainer::value_type* pdata, const typename TContainer::allocator_type& allocator)
+{
+    TContainer(pdata, pdata, allocator);
+};
+
+template<typename TContainer>
+concept CoRandomSequenceGeneratorReusableContainer = requires(TContainer& container, typename TContainer::value_type* pdata)
+{
+    container.assign(pdata, pdata);
+    container.insert(container.end(), pdata, pdata);
+};
+
+// Ring of the generated buffers grows up to the max buffers when the consumers outpace the refill of a single buffer and
+// shrinks back once the consumption slows down. When the unread rest of the active buffer drops below the low-water mark
+// part of the buffer while the next one isn't filled yet, the ring is grown ahead of the consumer instead of after its wait
+struct SRandomSequenceBuffering
+{
+    size_t _minBuffers = 2;
+    size_t _maxBuffers = 2;
+    double _lowWaterMark = 0.0;
+};
+
 class CRandomSequenceGenerator
 {
 public:
     using FDecreaseThreadPriority = std::function<void()>;
     using TByte = uint8_t;
     using TBuffer = std::vector<TByte>;
-    enum EGeneratorType { CPU_GENERATOR, GPU_GENERATOR, GPU_IF_POSSIBLE_GENERATOR };
+    // ChaCha generators are cryptographically secure, the number is the amount of rounds
+    enum EGeneratorType { CPU_GENERATOR, GPU_GENERATOR, GPU_IF_POSSIBLE_GENERATOR, CHACHA8_GENERATOR, CHACHA12_GENERATOR, CHACHA20_GENERATOR };
+    enum EHealthTest { REPETITION_COUNT_TEST, ADAPTIVE_PROPORTION_TEST, DUPLICATE_BUFFER_TEST };
+    using FHealthTestFailed = std::function<void(EHealthTest failedTest)>;
+    using FBytesReady = std::function<void()>;
+    using SBuffering = SRandomSequenceBuffering;
+    using TSnapshot = std::vector<TByte>;
 
     struct SStatistics
     {
         using TTimeMeasurement = std::chrono::nanoseconds;
         TTimeMeasurement _generate;
         TTimeMeasurement _store;
+        TTimeMeasurement _healthTest{ 0 };
         size_t _bufSize;
+        size_t _buffers{ 0 };
+        double _consumptionRate{ 0 };       // bytes per second
+        // CPU engine has taken over the ring of the failed backend, the latency is measured from the failure
+        // to the first bytes it has published
+        bool _failedOver{ false };
+        TTimeMeasurement _failoverLatency{ 0 };
     };
 
-    static std::unique_ptr<CRandomSequenceGenerator> Make(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType = GPU_IF_POSSIBLE_GENERATOR);
+    struct SWriteReport
+    {
+        using TTimeMeasurement = std::chrono::nanoseconds;
+        size_t _bytes;
+        TTimeMeasurement _duration;
+        double _bytesPerSecond;
+    };
+
+    // Health tests check every produced buffer when the failure callback is set, failed buffer is regenerated instead of being published.
+    // Explicitly seeded generator produces the same sequence for the same requests, its ring of buffers isn't adapted then
+    // and the ChaCha generator isn't reseeded from the OS
+    static std::unique_ptr<CRandomSequenceGenerator> Make(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType = GPU_IF_POSSIBLE_GENERATOR, FHealthTestFailed healthTestFailedCallback = nullptr, const SBuffering& buffering = {}, std::optional<uint64_t> seed = std::nullopt);
 
+    // Generator of the snapshot type and buffer size continues the sequence from the byte following the snapshot
+    static std::unique_ptr<CRandomSequenceGenerator> Restore(const TSnapshot& snapshot, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback = nullptr, const SBuffering& buffering = {});
+
+    static std::unique_ptr<CRandomSequenceGenerator> MakeSharedClient(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback = nullptr);
+
+    // Generated by the engine of the calling thread, it is seeded on the first call within the thread
     static TBuffer GetBytesOnce(size_t bytesAmount);
+    static void GetBytesOnce(std::span<TByte> bytes);
+    // Following GetBytesOnce / GetDataOnce calls of the calling thread are reproducible
+    static void SeedBytesOnce(uint64_t seed);
 
     template<typename TData>
     requires std::is_pod_v<TData>
     static std::vector<TData> GetDataOnce(size_t bytesAmount)
     {
-        TBuffer bytes = GetBytesOnce(sizeof(TData) * bytesAmount);
-        TData* dataPtr = reinterpret_cast<TData*>(bytes.data());
-        std::vector<TData> datas(dataPtr, dataPtr + bytesAmount);
+        std::vector<TData> datas(bytesAmount);
+        GetDataOnce(std::span<TData>(datas));
         return datas;
     }
 
+    template<typename TData>
+    requires std::is_pod_v<TData>
+    static void GetDataOnce(std::span<TData> datas)
+    {
+        GetBytesOnce(std::span<TByte>(reinterpret_cast<TByte*>(datas.data()), datas.size_bytes()));
+    }
+
     CRandomSequenceGenerator(size_t memorySizeInBytes);
     virtual ~CRandomSequenceGenerator() noexcept = default;
 
     virtual bool ReadyToWork() const noexcept = 0;
+    // Blocks until the first bytes are published instead of polling ReadyToWork, returns false on the timeout.
+    // Throws std::runtime_error when the producer has failed
+    virtual bool WaitUntilReady(std::chrono::milliseconds timeout);
     size_t BufferSize() const noexcept { return _bufferSize; }
+    // False for the generator taking no consumers lock, its requests must not overlap
+    virtual bool ConcurrentConsumers() const noexcept { return true; }
 
+    // Requests throw std::runtime_error once the producer has failed and no failover is possible
     template<typename TData>
     requires std::is_pod_v<TData>
-    TData GetValue(void) noexcept
+    TData GetValue(void)
     {
         TSpan buffer = GetRandomBytes(sizeof(TData));
         TData data = *reinterpret_cast<TData*>(buffer.data());
@@ -78,15 +155,190 @@ public:
         return container;
     }
 
+    // Container memory comes from the allocator, std::pmr containers take the memory resource pointer
+    template<CoRandomSequenceGeneratorAllocatorContainer TContainer>
+    TContainer GetValues(size_t arraySize, const typename TContainer::allocator_type& allocator)
+    {
+        using TData = TContainer::value_type;
+        std::span<TData> span = GetDataSpan<TData>(arraySize);
+        return TContainer(span.data(), span.data() + arraySize, allocator);
+    }
+
+    // Values replace the elements of the container, its capacity is reused
+    template<CoRandomSequenceGeneratorReusableContainer TContainer>
+    void AssignValues(TContainer& container, size_t arraySize)
+    {
+        using TData = TContainer::value_type;
+        std::span<TData> span = GetDataSpan<TData>(arraySize);
+        container.assign(span.data(), span.data() + arraySize);
+    }
+
+    // Values are appended to the elements of the container
+    template<CoRandomSequenceGeneratorReusableContainer TContainer>
+    void AppendValues(TContainer& container, size_t arraySize)
+    {
+        using TData = TContainer::value_type;
+        std::span<TData> span = GetDataSpan<TData>(arraySize);
+        container.insert(container.end(), span.data(), span.data() + arraySize);
+    }
+
+    // Bits come from the word cursor of the calling thread, the rest of the word is kept for the next call of the same thread.
+    // Up to 64 bits, the lowest bits of the result are set
+    uint64_t GetBits(size_t bitsAmount);
+    bool GetBool() { return GetBits(1) != 0; }
+
+    void FillBits(std::vector<bool>& bits) { FillBitsByWords(bits, bits.size()); }
+
+    // Bitset up to the word size is built from the single word
+    template<size_t bitsAmount>
+    void FillBits(std::bitset<bitsAmount>& bits)
+    {
+        if constexpr (bitsAmount <= _wordBits)
+            bits = std::bitset<bitsAmount>(GetValue<uint64_t>());
+        else
+            FillBitsByWords(bits, bitsAmount);
+    }
+
+    // Every bit of the mask is set with the probability rounded to 2^-32. Random words are combined by AND / OR along
+    // the binary digits of the probability, at most 32 words per mask word and one for the probability 0.5
+    void GetBernoulliMask(std::span<uint64_t> mask, double probability);
+
+    // Never blocks : fails when the bytes can be served only after the producer refills a buffer
+    template<typename TData>
+    requires std::is_pod_v<TData>
+    std::optional<TData> TryGetValue(void)
+    {
+        TSpan buffer = TryGetRandomBytes(sizeof(TData));
+        if (buffer.empty())
+            return std::nullopt;
+
+        TData data = *reinterpret_cast<TData*>(buffer.data());
+        return data;
+    }
+
+    template<typename TData>
+    requires std::is_pod_v<TData>
+    std::span<TData> TryGetDataSpan(size_t arraySize)
+    {
+        TSpan buffer = TryGetRandomBytes(sizeof(TData) * arraySize);
+        TData* dataPtr = reinterpret_cast<TData*>(buffer.data());
+        std::span<TData> span(dataPtr, buffer.empty() ? 0 : arraySize);
+        return span;
+    }
+
+    bool TryGetBytes(std::span<TByte> bytes);
+
+    // Callback is called on the calling thread when the bytes are available at once, otherwise on the producer
+    // thread as soon as the refilled buffer lands, it must not wait for the bytes of the same generator then.
+    // Queued requests are served in the order they were made
+    void GetBytesAsync(std::span<TByte> bytes, FBytesReady callback);
+
+    // co_await generator.AsyncGetBytes(bytes) resumes the coroutine on the producer thread when it has to wait
+    class CBytesAwaitable
+    {
+    public:
+        CBytesAwaitable(CRandomSequenceGenerator& generator, std::span<TByte> bytes) noexcept :
+            _generator(generator), _bytes(bytes)
+        {
+        }
+
+        // Bytes are taken at once by the suspension only when no earlier request is queued
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) { return _generator.QueueAsyncRequest(_bytes, [handle] { handle.resume(); }); }
+        void await_resume() const noexcept {}
+
+    private:
+        CRandomSequenceGenerator& _generator;
+        std::span<TByte> _bytes;
+    };
+
+    CBytesAwaitable AsyncGetBytes(std::span<TByte> bytes) noexcept { return CBytesAwaitable(*this, bytes); }
+
+    // File is written through the memory mapped windows, std::runtime_error is thrown when it can't be created or mapped
+    SWriteReport WriteToFile(const std::filesystem::path& path, size_t bytesAmount);
+
     virtual SStatistics Statistics() const noexcept = 0;
 
+    // Engine state and the position in the active buffer of the explicitly seeded generator, std::runtime_error is thrown otherwise
+    virtual TSnapshot Snapshot();
+
 protected:
     using TSpan = std::span<TByte>;
 
     virtual TSpan GetRandomBytes(size_t size) = 0;
+    // Returns empty span instead of waiting for the producer or for the other consumer
+    virtual TSpan TryGetRandomBytes(size_t size) = 0;
+    virtual void AsyncRequestQueued() {}
+    // Generator without the thread serving the queued requests throws std::logic_error on the asynchronous request
+    virtual bool AsyncRequestsServed() const noexcept { return true; }
+    // Bytes served from the active buffer without switching to the next one, zero when the implementation doesn't tell
+    virtual size_t ActiveBufferBytesLeft() noexcept { return 0; }
+
+    // Returns false while some of the queued requests still wait for the bytes
+    bool ServeAsyncRequests();
+    bool AsyncRequestsPending();
 
 private:
+    static constexpr size_t _wordBits = 64;
+
+    struct SAsyncRequest
+    {
+        std::span<TByte> _bytes;
+        FBytesReady _callback;
+    };
+
     const size_t _bufferSize;
+    // Bit cursors of the threads are bound to the instance, the address may be reused by the next generator
+    const uint64_t _instanceId;
+    std::mutex _asyncMutex;
+    std::deque<SAsyncRequest> _asyncRequests;
+
+    // Returns false when the request has been served at once, the callback isn't called then
+    bool QueueAsyncRequest(std::span<TByte> bytes, FBytesReady callback);
+
+    // Whole words are taken from the buffer, chunk by chunk. The containers give no portable access to their words :
+    // they are cleared at once and only the set bits of the words are written
+    template<typename TBits>
+    void FillBitsByWords(TBits& bits, size_t bitsAmount)
+    {
+        const size_t chunkWords = std::max<size_t>(BufferSize() / sizeof(uint64_t), 1);
+
+        if constexpr (requires { bits.reset(); })
+            bits.reset();
+        else
+            std::fill(bits.begin(), bits.end(), false);
+
+        for (size_t bit = 0; bit < bitsAmount; )
+        {
+            const size_t words = std::min(chunkWords, (bitsAmount - bit + _wordBits - 1) / _wordBits);
+            for (uint64_t word : GetDataSpan<uint64_t>(words))
+            {
+                if (bitsAmount - bit < _wordBits)
+                    word &= (uint64_t{ 1 } << (bitsAmount - bit)) - 1;
+
+                for (; word != 0; word &= word - 1)
+                    bits[bit + std::countr_zero(word)] = true;
+
+                bit += _wordBits;
+            }
+        }
+    }
+};
+
+// Publishes generated buffers into a named shared memory ring served to MakeSharedClient generators of other processes
+class CRandomSequencePublisher
+{
+public:
+    using EGeneratorType = CRandomSequenceGenerator::EGeneratorType;
+    using FDecreaseThreadPriority = CRandomSequenceGenerator::FDecreaseThreadPriority;
+    using FHealthTestFailed = CRandomSequenceGenerator::FHealthTestFailed;
+    using SStatistics = CRandomSequenceGenerator::SStatistics;
+
+    static std::unique_ptr<CRandomSequencePublisher> Make(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType = CRandomSequenceGenerator::GPU_IF_POSSIBLE_GENERATOR, FHealthTestFailed healthTestFailedCallback = nullptr);
+
+    virtual ~CRandomSequencePublisher() noexcept = default;
+
+    virtual SStatistics Statistics() const noexcept = 0;
 };
 
 #endif // RANDOM_SEQUENCE_GENERATOR_INTERFACE_
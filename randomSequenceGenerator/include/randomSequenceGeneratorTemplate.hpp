@@ -0,0 +1,280 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_TEMPLATE_
+#define RANDOM_SEQUENCE_GENERATOR_TEMPLATE_
+
+#include <cassert>
+#include <chrono>
+#include <concepts>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "randomSequenceGenerator.hpp"
+#include "doubleBuffersRandomSequenceGenerator.hpp"
+
+// Engine produces full width words, so every bit of every word is used for the buffer filling
+template<typename TEngine>
+concept CoRandomSequenceEngine = std::uniform_random_bit_generator<TEngine> &&
+    std::default_initializable<TEngine> &&
+    requires(TEngine engine, uint64_t seed)
+    {
+        engine.seed(seed);
+    } &&
+    (TEngine::min() == 0) && (TEngine::max() == std::numeric_limits<typename TEngine::result_type>::max());
+
+// Engine state is kept in the snapshot as the text of the stream operators
+template<typename TEngine>
+concept CoStreamableRandomSequenceEngine = requires(std::istream& input, std::ostream& output, TEngine& engine)
+{
+    output << engine;
+    input >> engine;
+};
+
+// mt19937_64 XOR minstd combination used by the CPU generator
+class CMtXorLceEngine
+{
+public:
+    using result_type = uint64_t;
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+    void seed(uint64_t seed)
+    {
+        _lceGen.seed(static_cast<unsigned int>(seed));
+
+        static constexpr uint64_t seedMask = 0xAAAAAAAA;
+        _mtGen.seed(seed ^ seedMask);
+    }
+
+    result_type operator()()
+    {
+        // minstd gives 31 bits, two of them cover the word being XORed with the full width mt19937_64 output
+        const result_type lce = static_cast<result_type>(_lceGen()) << 33 ^ _lceGen();
+        return _mtGen() ^ lce;
+    }
+
+    friend std::ostream& operator<<(std::ostream& stream, const CMtXorLceEngine& engine)
+    {
+        // linear_congruential_engine of libstdc++ doesn't skip the leading whitespace
+        return stream << engine._lceGen << ' ' << engine._mtGen;
+    }
+
+    friend std::istream& operator>>(std::istream& stream, CMtXorLceEngine& engine)
+    {
+        return stream >> engine._lceGen >> engine._mtGen;
+    }
+
+private:
+    std::mt19937_64 _mtGen;
+    std::minstd_rand _lceGen;
+};
+
+template<CoRandomSequenceEngine TEngine>
+inline void FillRandomBytes(TEngine& engine, uint8_t* data, size_t size)
+{
+    using TWord = typename TEngine::result_type;
+
+    size_t i = 0;
+    for (; i + sizeof(TWord) <= size; i += sizeof(TWord))
+    {
+        const TWord word = engine();
+        std::memcpy(data + i, &word, sizeof(word));
+    }
+
+    if (i < size)
+    {
+        const TWord word = engine();
+        std::memcpy(data + i, &word, size - i);
+    }
+}
+
+// Ring of minBuffers grows up to maxBuffers while the consumers outpace the producer
+template<size_t minBuffers, size_t maxBuffers = minBuffers>
+struct TBuffersPolicy
+{
+    static_assert(minBuffers >= 2, "At least two buffers are required to generate while consuming");
+    static_assert(maxBuffers >= minBuffers, "Max buffers should not be less than the min buffers");
+    static constexpr SRandomSequenceBuffering _buffering{ minBuffers, maxBuffers };
+};
+
+// Random bytes may be requested from any thread
+struct SMultipleConsumersPolicy
+{
+    static constexpr bool _singleConsumer = false;
+};
+
+// Random bytes are requested from the single thread only, consumer path takes no lock.
+// Asynchronous requests throw std::logic_error as the producer thread would be the second consumer
+struct SSingleConsumerPolicy
+{
+    static constexpr bool _singleConsumer = true;
+};
+
+// Compile time configured backend of the buffers ring : engine step is inlined into the fill loop, GetValue and GetDataSpan called
+// on this type serve the active buffer inline, the single consumer policy takes no lock there. The calls through the base class
+// and the requests that switch the buffer go by the virtual path. Health tests, seeding, snapshots and the failover come from
+// the ring, CCPURandomSequenceGenerator is the instantiation with the default engine
+template<CoRandomSequenceEngine TEngine = CMtXorLceEngine, typename TBufferPolicy = TBuffersPolicy<2>, typename TLockPolicy = SMultipleConsumersPolicy>
+class TRandomSequenceGenerator final : public CDoubleBuffersRandomSequenceGenerator
+{
+    static_assert(!TLockPolicy::_singleConsumer || TBufferPolicy::_buffering._minBuffers == TBufferPolicy::_buffering._maxBuffers,
+        "Ring of the single consumer generator can't be resized");
+
+public:
+    TRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback = nullptr, std::optional<uint64_t> seed = std::nullopt) :
+        TRandomSequenceGenerator(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, TBufferPolicy::_buffering,
+            seed ? std::optional<SStreamPosition>(SStreamPosition{ *seed, {}, 0 }) : std::nullopt)
+    {
+    }
+
+    // Ring configuration is given at run time, the buffers policy gives the default one
+    TRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering, const std::optional<SStreamPosition>& startPosition) :
+        CDoubleBuffersRandomSequenceGenerator(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, startPosition, TLockPolicy::_singleConsumer)
+    {
+        // Broken snapshot is reported to the caller instead of the producer thread
+        if (startPosition && !startPosition->_engineState.empty())
+        {
+            if constexpr (CoStreamableRandomSequenceEngine<TEngine>)
+            {
+                std::istringstream stream(std::string(startPosition->_engineState.begin(), startPosition->_engineState.end()));
+                stream >> _engine;
+                if (!stream)
+                    throw std::runtime_error("Engine state of the snapshot is corrupted");
+            }
+            else
+            {
+                throw std::runtime_error("Engine state can't be restored for the engine without the stream operators");
+            }
+        }
+        else if (startPosition)
+        {
+            _engine.seed(startPosition->_seed);
+        }
+
+        InitBase();
+    }
+
+    ~TRandomSequenceGenerator() noexcept override
+    {
+        StopThread();
+    }
+
+    // Snapshot of the generator of the same type continues its sequence
+    static std::unique_ptr<TRandomSequenceGenerator> Restore(const TSnapshot& snapshot, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback = nullptr)
+    {
+        const SSnapshot parsed = ParseSnapshot(snapshot);
+        if (parsed._generatorType != CPU_GENERATOR)
+            throw std::runtime_error("Snapshot has been taken from the generator of the other type");
+
+        return std::make_unique<TRandomSequenceGenerator>(parsed._bufferSize, decreaseThreadPriorityCallback, healthTestFailedCallback, TBufferPolicy::_buffering, parsed._position);
+    }
+
+    template<typename TData>
+    requires std::is_pod_v<TData>
+    TData GetValue(void)
+    {
+        const TSpan buffer = TakeFromActiveBuffer(sizeof(TData));
+        if (buffer.empty())
+            return CRandomSequenceGenerator::GetValue<TData>();
+
+        return *reinterpret_cast<const TData*>(buffer.data());
+    }
+
+    template<typename TData>
+    requires std::is_pod_v<TData>
+    std::span<TData> GetDataSpan(size_t arraySize)
+    {
+        const TSpan buffer = TakeFromActiveBuffer(sizeof(TData) * arraySize);
+        if (buffer.empty())
+            return CRandomSequenceGenerator::GetDataSpan<TData>(arraySize);
+
+        return std::span<TData>(reinterpret_cast<TData*>(buffer.data()), arraySize);
+    }
+
+    TSnapshot Snapshot() override
+    {
+        if constexpr (CoStreamableRandomSequenceEngine<TEngine>)
+            return CDoubleBuffersRandomSequenceGenerator::Snapshot();
+        else
+            throw std::runtime_error("Engine state can't be stored for the engine without the stream operators");
+    }
+
+private:
+    TEngine _engine;
+    std::vector<TBuffer> _buffer;
+
+    void AllocBuffers(size_t buffers, size_t bytesInBuffer) override
+    {
+        _buffer.resize(buffers);
+
+        for (size_t i = 0; i < buffers; ++i)
+            _buffer[i].resize(bytesInBuffer);
+    }
+
+    bool ImplInit() override
+    {
+        if (StartPosition())
+            return true;
+
+        // Clock alone gives the same seed to the generators started at once
+        std::random_device device;
+        const uint64_t deviceSeed = static_cast<uint64_t>(device()) << 32 | device();
+        _engine.seed(deviceSeed ^ static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+
+        return true;
+    }
+
+    bool FillBuffer(size_t bufferNum, size_t offset, size_t size) override
+    {
+        assert(bufferNum < _buffer.size());
+        assert(offset + size <= _buffer[bufferNum].size());
+
+        const auto startTimePoint = std::chrono::steady_clock::now();
+        FillRandomBytes(_engine, _buffer[bufferNum].data() + offset, size);
+        const auto endTimePoint = std::chrono::steady_clock::now();
+
+        SStatistics stat;
+        stat._generate = std::chrono::duration_cast<SStatistics::TTimeMeasurement>(endTimePoint - startTimePoint);
+        stat._store = SStatistics::TTimeMeasurement{ 0 };
+
+        SetStatistics(stat);
+
+        return true;
+    }
+
+    TByte* Array(size_t bufferNum) noexcept override
+    {
+        assert(bufferNum < _buffer.size());
+        return _buffer[bufferNum].data();
+    }
+
+    // Engine without the stream operators is never snapshotted, its state isn't needed
+    TBuffer EngineState() const override
+    {
+        if constexpr (CoStreamableRandomSequenceEngine<TEngine>)
+        {
+            std::ostringstream stream;
+            stream << _engine;
+            const std::string state = stream.str();
+            return TBuffer(state.begin(), state.end());
+        }
+        else
+        {
+            return TBuffer();
+        }
+    }
+
+    EGeneratorType GeneratorType() const noexcept override { return CPU_GENERATOR; }
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_TEMPLATE_
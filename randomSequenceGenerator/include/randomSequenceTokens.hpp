@@ -0,0 +1,69 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_TOKENS_
+#define RANDOM_SEQUENCE_GENERATOR_TOKENS_
+
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "randomSequenceGenerator.hpp"
+
+// Tokens of the same length stored one after another in a single string
+class CTokenArena
+{
+public:
+    CTokenArena(size_t tokensAmount, size_t tokenLength) :
+        _tokenLength(tokenLength), _characters(tokensAmount * tokenLength, '\0')
+    {
+    }
+
+    size_t Size() const noexcept { return _tokenLength ? _characters.size() / _tokenLength : 0; }
+    size_t TokenLength() const noexcept { return _tokenLength; }
+
+    std::string_view operator[](size_t token) const noexcept
+    {
+        return std::string_view(_characters).substr(token * _tokenLength, _tokenLength);
+    }
+
+    std::span<char> Characters() noexcept { return _characters; }
+    const std::string& Characters() const noexcept { return _characters; }
+
+private:
+    size_t _tokenLength;
+    std::string _characters;
+};
+
+inline constexpr std::string_view hexAlphabet = "0123456789abcdef";
+inline constexpr std::string_view base64UrlAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+inline constexpr std::string_view alphanumericAlphabet = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Every character is uniform over the alphabet of up to 256 characters : the byte of the buffer masked to the alphabet size
+// rounded up to the power of two is rejected when it is out of the alphabet. Alphabets up to 64 characters are encoded
+// by the AVX2 table lookups 32 characters at once
+void FillTokenCharacters(CRandomSequenceGenerator& generator, std::string_view alphabet, std::span<char> characters);
+
+CTokenArena GetTokens(CRandomSequenceGenerator& generator, size_t tokensAmount, size_t tokenLength, std::string_view alphabet);
+
+inline CTokenArena GetHexTokens(CRandomSequenceGenerator& generator, size_t tokensAmount, size_t tokenLength)
+{
+    return GetTokens(generator, tokensAmount, tokenLength, hexAlphabet);
+}
+
+inline CTokenArena GetBase64UrlTokens(CRandomSequenceGenerator& generator, size_t tokensAmount, size_t tokenLength)
+{
+    return GetTokens(generator, tokensAmount, tokenLength, base64UrlAlphabet);
+}
+
+inline CTokenArena GetAlphanumericTokens(CRandomSequenceGenerator& generator, size_t tokensAmount, size_t tokenLength)
+{
+    return GetTokens(generator, tokensAmount, tokenLength, alphanumericAlphabet);
+}
+
+// RFC 4122 version 4 UUIDs in the lowercase 8-4-4-4-12 form, 122 random bits each
+inline constexpr size_t uuidLength = 36;
+
+// Characters amount must be a multiple of the UUID length
+void FillUuids(CRandomSequenceGenerator& generator, std::span<char> characters);
+
+CTokenArena GetUuids(CRandomSequenceGenerator& generator, size_t uuidsAmount);
+
+#endif // RANDOM_SEQUENCE_GENERATOR_TOKENS_
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <Windows.h>
+#else // _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif // _WIN32
+
+#include "include/kernelConfigCache.hpp"
+
+// Generators of the process may tune the kernels at the same time, the cache file is rewritten under the lock
+static std::mutex kernelConfigCacheMutex;
+
+// Fails when the file exists, the file planted by the other user is never written through
+static bool CreateExclusively(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    CloseHandle(file);
+#else // _WIN32
+    const int file = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (file == -1)
+        return false;
+
+    close(file);
+#endif // _WIN32
+    return true;
+}
+
+/* static */ std::filesystem::path CKernelConfigCache::UserCachePath()
+{
+    std::filesystem::path directory;
+
+#ifdef _WIN32
+    // Local application data is accessible to its user only
+    wchar_t* localAppData = nullptr;
+    if (_wdupenv_s(&localAppData, nullptr, L"LOCALAPPDATA") == 0 && localAppData)
+        directory = std::filesystem::path(localAppData) / "randomSequenceGenerator";
+    std::free(localAppData);
+#else // _WIN32
+    if (const char* cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome)
+        directory = std::filesystem::path(cacheHome) / "randomSequenceGenerator";
+    else if (const char* home = std::getenv("HOME"); home && *home)
+        directory = std::filesystem::path(home) / ".cache" / "randomSequenceGenerator";
+#endif // _WIN32
+
+    if (directory.empty())
+        return {};
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+#ifndef _WIN32
+    std::filesystem::permissions(directory, std::filesystem::perms::owner_all, error);
+#endif // _WIN32
+    if (error)
+        return {};
+
+    return directory / "kernels.txt";
+}
+
+std::optional<CKernelConfigCache::SKernelConfig> CKernelConfigCache::Load(const std::string& deviceKey) const
+{
+    if (_path.empty())
+        return std::nullopt;
+
+    std::lock_guard lock(kernelConfigCacheMutex);
+
+    std::ifstream cache(_path);
+    std::string line;
+    while (std::getline(cache, line))
+    {
+        const size_t separator = line.rfind('\t');
+        if (separator != deviceKey.size() || line.compare(0, separator, deviceKey) != 0)
+            continue;
+
+        SKernelConfig config;
+        std::istringstream stream(line.substr(separator + 1));
+        stream >> config._localSize >> config._itemsPerWorkItem >> config._vectorWidth;
+
+        // Broken line is tuned again, the values are checked against the work-group limit of the kernel by the generator
+        const bool parsed = !stream.fail() && (stream >> std::ws).eof();
+        if (parsed && Tuned(config))
+            return config;
+    }
+
+    return std::nullopt;
+}
+
+void CKernelConfigCache::Store(const std::string& deviceKey, const SKernelConfig& config) const
+{
+    if (_path.empty())
+        return;
+
+    std::lock_guard lock(kernelConfigCacheMutex);
+
+    std::vector<std::string> lines;
+    {
+        std::ifstream cache(_path);
+        std::string line;
+        while (std::getline(cache, line))
+            if (line.compare(0, deviceKey.size() + 1, deviceKey + '\t') != 0)
+                lines.push_back(line);
+    }
+
+    lines.push_back(deviceKey + '\t' + std::to_string(config._localSize) + ' ' + std::to_string(config._itemsPerWorkItem) + ' ' + std::to_string(config._vectorWidth));
+
+    // Readers of the other processes see either the old file or the new one, the failed write keeps the old one.
+    // Every writer has its own temporary file, the existing one is never opened
+    std::random_device randomDevice;
+    std::ostringstream suffix;
+    suffix << '.' << std::hex << randomDevice() << randomDevice() << ".tmp";
+
+    std::filesystem::path tempPath = _path;
+    tempPath += suffix.str();
+    if (!CreateExclusively(tempPath))
+        return;
+
+    {
+        std::ofstream cache(tempPath);
+        if (!cache)
+        {
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+
+        for (const std::string& line : lines)
+            cache << line << '\n';
+
+        cache.close();
+        if (!cache)
+        {
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, _path, error);
+    if (error)
+        std::filesystem::remove(tempPath, error);
+}
+
+/* static */ bool CKernelConfigCache::Tuned(const SKernelConfig& config) noexcept
+{
+    auto known = [](const auto& values, size_t value) { return std::find(values.begin(), values.end(), value) != values.end(); };
+
+    return known(_tunedLocalSizes, config._localSize) && known(_tunedItemsPerWorkItem, config._itemsPerWorkItem) && known(_tunedVectorWidths, config._vectorWidth);
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <Windows.h>
+#else // _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif // _WIN32
+
+#include "mappedFile.hpp"
+
+/* static */ std::unique_ptr<CMappedFile> CMappedFile::Create(const std::filesystem::path& path, size_t size)
+{
+    using namespace std::string_literals;
+
+    std::unique_ptr<CMappedFile> file(new CMappedFile);
+    file->_path = path;
+    file->_size = size;
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Unable to open file "s + path.string() + " for writing"s);
+    file->_file = handle;
+
+    // Mapping of the empty file can't be created, the file is only truncated then
+    if (size > 0)
+    {
+        const DWORD sizeHigh = static_cast<DWORD>(static_cast<uint64_t>(size) >> 32);
+        const DWORD sizeLow = static_cast<DWORD>(size & 0xffffffff);
+        file->_mapping = CreateFileMappingW(handle, nullptr, PAGE_READWRITE, sizeHigh, sizeLow, nullptr);
+        if (!file->_mapping)
+            throw std::runtime_error("Unable to map the file "s + path.string());
+    }
+#else // _WIN32
+    file->_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file->_fd < 0)
+        throw std::runtime_error("Unable to open file "s + path.string() + " for writing"s);
+
+    if (ftruncate(file->_fd, static_cast<off_t>(size)) != 0)
+        throw std::runtime_error("Unable to resize the file "s + path.string());
+#endif // _WIN32
+
+    return file;
+}
+
+CMappedFile::~CMappedFile() noexcept
+{
+    Unmap();
+
+#ifdef _WIN32
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+#else // _WIN32
+    if (_fd >= 0)
+        close(_fd);
+#endif // _WIN32
+}
+
+std::span<uint8_t> CMappedFile::MapWindow(size_t offset)
+{
+    using namespace std::string_literals;
+
+    assert(offset % _windowSize == 0 && offset < _size);
+    Unmap();
+
+    const size_t viewSize = std::min(_windowSize, _size - offset);
+
+#ifdef _WIN32
+    const DWORD offsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+    const DWORD offsetLow = static_cast<DWORD>(offset & 0xffffffff);
+    _view = MapViewOfFile(_mapping, FILE_MAP_WRITE, offsetHigh, offsetLow, viewSize);
+#else // _WIN32
+    void* view = mmap(nullptr, viewSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, static_cast<off_t>(offset));
+    _view = view == MAP_FAILED ? nullptr : view;
+#endif // _WIN32
+
+    if (!_view)
+        throw std::runtime_error("Unable to map the file "s + _path.string());
+
+    _viewSize = viewSize;
+    return std::span<uint8_t>(static_cast<uint8_t*>(_view), viewSize);
+}
+
+void CMappedFile::Close()
+{
+    using namespace std::string_literals;
+
+    Unmap();
+
+#ifdef _WIN32
+    const bool closed = (!_mapping || CloseHandle(_mapping)) && CloseHandle(_file);
+    _mapping = nullptr;
+    _file = nullptr;
+#else // _WIN32
+    const bool closed = close(_fd) == 0;
+    _fd = -1;
+#endif // _WIN32
+
+    if (!closed)
+        throw std::runtime_error("Unable to close the file "s + _path.string());
+}
+
+// Write back of the window is started without waiting for it
+void CMappedFile::Unmap() noexcept
+{
+    if (!_view)
+        return;
+
+#ifdef _WIN32
+    FlushViewOfFile(_view, 0);
+    UnmapViewOfFile(_view);
+#else // _WIN32
+    msync(_view, _viewSize, MS_ASYNC);
+    munmap(_view, _viewSize);
+#endif // _WIN32
+
+    _view = nullptr;
+    _viewSize = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_MAPPED_FILE_
+#define RANDOM_SEQUENCE_GENERATOR_MAPPED_FILE_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+// File of the fixed size written through the memory mapped windows. The OS writes the pages of the unmapped window back
+// while the next one is being filled
+class CMappedFile
+{
+public:
+    // Multiple of the page size and of the Windows allocation granularity
+    static constexpr size_t _windowSize = 64 * 1024 * 1024;
+
+    static std::unique_ptr<CMappedFile> Create(const std::filesystem::path& path, size_t size);
+
+    ~CMappedFile() noexcept;
+
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    // Previous window is unmapped, the offset must be a multiple of the window size
+    std::span<uint8_t> MapWindow(size_t offset);
+    void Close();
+
+private:
+    CMappedFile() = default;
+
+    void Unmap() noexcept;
+
+    std::filesystem::path _path;
+    size_t _size = 0;
+    void* _view = nullptr;
+    size_t _viewSize = 0;
+#ifdef _WIN32
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#else // _WIN32
+    int _fd = -1;
+#endif // _WIN32
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_MAPPED_FILE_
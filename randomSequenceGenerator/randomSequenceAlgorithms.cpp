@@ -0,0 +1,123 @@
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "include/randomSequenceAlgorithms.hpp"
+
+std::vector<uint64_t> SampleIndexes(CRandomSequenceGenerator& generator, uint64_t populationSize, size_t sampleSize)
+{
+    if (sampleSize > populationSize)
+    {
+        using namespace std::string_literals;
+        throw std::out_of_range("Sample size "s + std::to_string(sampleSize) + " is bigger than the population size "s + std::to_string(populationSize));
+    }
+
+    // All the indexes are kept when the sample is a noticeable part of the population, the shuffle is cheaper than hashing then
+    static constexpr uint64_t densePopulationPart = 16;
+
+    CRandomWords words(generator);
+
+    if (sampleSize >= populationSize / densePopulationPart)
+    {
+        std::vector<uint64_t> indexes(populationSize);
+        std::iota(indexes.begin(), indexes.end(), uint64_t{ 0 });
+        PartialShuffle(words, std::span<uint64_t>(indexes), sampleSize);
+        indexes.erase(indexes.begin(), indexes.end() - sampleSize);
+        return indexes;
+    }
+
+    std::unordered_set<uint64_t> taken;
+    taken.reserve(sampleSize);
+
+    std::vector<uint64_t> indexes;
+    indexes.reserve(sampleSize);
+
+    for (uint64_t bound = populationSize - sampleSize + 1; bound <= populationSize; ++bound)
+    {
+        const uint64_t index = words.Below(bound);
+        const uint64_t sampled = taken.insert(index).second ? index : bound - 1;
+        taken.insert(sampled);
+        indexes.push_back(sampled);
+    }
+
+    // Floyd's algorithm gives the uniform set but not the uniform order
+    Shuffle(words, std::span<uint64_t>(indexes));
+    return indexes;
+}
+
+CAliasSampler::CAliasSampler(std::span<const double> weights) :
+    _threshold(weights.size()), _alias(weights.size())
+{
+    using namespace std::string_literals;
+
+    if (weights.empty() || weights.size() > std::numeric_limits<uint32_t>::max())
+        throw std::length_error("Categories amount "s + std::to_string(weights.size()) + " is out of [1, 2^32)"s);
+
+    double sum = 0.0;
+    for (double weight : weights)
+    {
+        if (!(weight >= 0.0 && std::isfinite(weight)))
+            throw std::out_of_range("Weight "s + std::to_string(weight) + " is not a non-negative number"s);
+        sum += weight;
+    }
+
+    if (sum <= 0.0)
+        throw std::out_of_range("Weights sum is zero");
+
+    // Probabilities scaled by the categories amount : the columns under 1 are topped up by the ones over 1
+    std::vector<double> scaled(weights.size());
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        scaled[i] = weights[i] * weights.size() / sum;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    const auto threshold = [](double probability)
+    {
+        return probability >= 1.0 ? std::numeric_limits<uint64_t>::max() : static_cast<uint64_t>(std::ldexp(probability, 64));
+    };
+
+    while (!small.empty() && !large.empty())
+    {
+        const uint32_t less = small.back();
+        small.pop_back();
+        const uint32_t more = large.back();
+
+        _threshold[less] = threshold(scaled[less]);
+        _alias[less] = more;
+
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+
+    // Rounding leaves the columns that are full up to the error
+    for (std::vector<uint32_t>* rest : { &small, &large })
+        for (uint32_t column : *rest)
+        {
+            _threshold[column] = threshold(1.0);
+            _alias[column] = column;
+        }
+}
+
+void CAliasSampler::Sample(CRandomSequenceGenerator& generator, std::span<uint32_t> indexes)
+{
+    const size_t chunkWords = std::max<size_t>(generator.BufferSize() / sizeof(uint64_t), 1);
+
+    for (size_t begin = 0; begin < indexes.size(); begin += chunkWords)
+    {
+        std::span<uint32_t> indexesChunk = indexes.subspan(begin, std::min(chunkWords, indexes.size() - begin));
+        std::span<uint64_t> words = generator.GetDataSpan<uint64_t>(indexesChunk.size());
+
+        for (size_t i = 0; i < indexesChunk.size(); ++i)
+            indexesChunk[i] = Lookup(words[i]);
+    }
+}
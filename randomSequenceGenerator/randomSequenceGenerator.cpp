@@ -1,19 +1,32 @@
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cmath>
+#include <string>
 #include <stdexcept>
+#include <thread>
 
 #include "include/randomSequenceGenerator.hpp"
+#include "include/randomSequenceGeneratorTemplate.hpp"
 
 #include "CPUrandomSequenceGenerator.hpp"
+#include "chachaRandomSequenceGenerator.hpp"
 #include "GPUrandomSequenceGenerator.hpp"
+#include "mappedFile.hpp"
+#include "sharedMemoryRandomSequenceGenerator.hpp"
+#include "warmUpRandomSequenceGenerator.hpp"
 
-/* static */ std::unique_ptr<CRandomSequenceGenerator> CRandomSequenceGenerator::Make(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType)
+using SStreamPosition = CDoubleBuffersRandomSequenceGenerator::SStreamPosition;
+
+static std::unique_ptr<CRandomSequenceGenerator> MakeAt(size_t memorySizeInBytes, CRandomSequenceGenerator::FDecreaseThreadPriority decreaseThreadPriorityCallback, CRandomSequenceGenerator::EGeneratorType generatorType, CRandomSequenceGenerator::FHealthTestFailed healthTestFailedCallback, const CRandomSequenceGenerator::SBuffering& buffering, const std::optional<SStreamPosition>& startPosition)
 {
     switch (generatorType)
     {
-    case GPU_GENERATOR:
+    case CRandomSequenceGenerator::GPU_GENERATOR:
         if (CGPURandomSequenceGenerator::CheckOpenCLdevicesAvailability())
-            return std::make_unique<CGPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback);
+            return std::make_unique<CGPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, startPosition);
         else
             throw std::runtime_error("No OpenCL device has been found");
 
@@ -21,41 +34,304 @@
         assert(false);
         [[fallthrough]];
 
-    case GPU_IF_POSSIBLE_GENERATOR:
-        if (CGPURandomSequenceGenerator::CheckOpenCLdevicesAvailability())
-            return std::make_unique<CGPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback);
+    case CRandomSequenceGenerator::GPU_IF_POSSIBLE_GENERATOR:
+        // Seeded sequence is produced by a single backend, the handover would make it depend on the GPU warm-up time
+        if (!startPosition)
+            return std::make_unique<CWarmUpRandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering);
+        else if (CGPURandomSequenceGenerator::CheckOpenCLdevicesAvailability())
+            return std::make_unique<CGPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, startPosition);
         else
-            return std::make_unique<CCPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback);
+            return std::make_unique<CCPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, startPosition);
+
+    case CRandomSequenceGenerator::CPU_GENERATOR:
+        return std::make_unique<CCPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, startPosition);
+
+    case CRandomSequenceGenerator::CHACHA8_GENERATOR:
+        return std::make_unique<CChaChaRandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, 8, healthTestFailedCallback, buffering, startPosition);
 
-    case CPU_GENERATOR:
-        return std::make_unique<CCPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback);
+    case CRandomSequenceGenerator::CHACHA12_GENERATOR:
+        return std::make_unique<CChaChaRandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, 12, healthTestFailedCallback, buffering, startPosition);
+
+    case CRandomSequenceGenerator::CHACHA20_GENERATOR:
+        return std::make_unique<CChaChaRandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, 20, healthTestFailedCallback, buffering, startPosition);
     }
 }
 
+/* static */ std::unique_ptr<CRandomSequenceGenerator> CRandomSequenceGenerator::Make(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering, std::optional<uint64_t> seed)
+{
+    std::optional<SStreamPosition> startPosition;
+    if (seed)
+        startPosition = SStreamPosition{ *seed, {}, 0 };
+
+    return MakeAt(memorySizeInBytes, decreaseThreadPriorityCallback, generatorType, healthTestFailedCallback, buffering, startPosition);
+}
+
+/* static */ std::unique_ptr<CRandomSequenceGenerator> CRandomSequenceGenerator::Restore(const TSnapshot& snapshot, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering)
+{
+    const CDoubleBuffersRandomSequenceGenerator::SSnapshot parsed = CDoubleBuffersRandomSequenceGenerator::ParseSnapshot(snapshot);
+    return MakeAt(parsed._bufferSize, decreaseThreadPriorityCallback, parsed._generatorType, healthTestFailedCallback, buffering, parsed._position);
+}
+
+/* static */ std::unique_ptr<CRandomSequenceGenerator> CRandomSequenceGenerator::MakeSharedClient(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback)
+{
+    return std::make_unique<CSharedMemoryRandomSequenceGenerator>(sharedName, memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback);
+}
+
+/* static */ std::unique_ptr<CRandomSequencePublisher> CRandomSequencePublisher::Make(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType, FHealthTestFailed healthTestFailedCallback)
+{
+    return std::make_unique<CSharedMemoryRandomSequencePublisher>(sharedName, memorySizeInBytes, decreaseThreadPriorityCallback, generatorType, healthTestFailedCallback);
+}
+
+static std::atomic<uint64_t> instancesCreated{ 0 };
+
 CRandomSequenceGenerator::CRandomSequenceGenerator(size_t memorySizeInBytes) :
-    _bufferSize(memorySizeInBytes)
+    _bufferSize(memorySizeInBytes), _instanceId(++instancesCreated)
 {
     if (_bufferSize == 0)
         throw std::length_error("Zero size buffer asked while non-zero size one is required");
 }
 
-/* static */ CRandomSequenceGenerator::TBuffer CRandomSequenceGenerator::GetBytesOnce(size_t bytesAmount)
+static CMtXorLceEngine& ThreadEngine(std::optional<uint64_t> seed = std::nullopt)
 {
-    auto seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::minstd_rand lceGen;
-    lceGen.seed(static_cast<unsigned int>(seed));
+    thread_local CMtXorLceEngine engine;
+    thread_local bool seeded = false;
 
-    static constexpr size_t seedMask = 0xAAAAAAAA;
-    seed ^= seedMask;
-    std::mt19937_64 mtGen;
-    mtGen.seed(seed);
+    if (seed)
+    {
+        engine.seed(*seed);
+        seeded = true;
+    }
+    else if (!seeded) [[unlikely]]
+    {
+        // Threads started at the same moment still get different sequences
+        const uint64_t time = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        const uint64_t thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        engine.seed(time ^ thread * 0x9e3779b97f4a7c15ULL);
+        seeded = true;
+    }
 
-    std::uniform_int_distribution<> distribution;
+    return engine;
+}
 
+/* static */ CRandomSequenceGenerator::TBuffer CRandomSequenceGenerator::GetBytesOnce(size_t bytesAmount)
+{
     TBuffer buffer(bytesAmount);
-    for (TByte& byte : buffer)
-        byte = static_cast<TByte>(distribution(mtGen) ^ distribution(lceGen));
-
+    GetBytesOnce(buffer);
     return buffer;
+}
+
+/* static */ void CRandomSequenceGenerator::GetBytesOnce(std::span<TByte> bytes)
+{
+    FillRandomBytes(ThreadEngine(), bytes.data(), bytes.size());
+}
+
+/* static */ void CRandomSequenceGenerator::SeedBytesOnce(uint64_t seed)
+{
+    ThreadEngine(seed);
+}
+
+bool CRandomSequenceGenerator::WaitUntilReady(std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!ReadyToWork())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+
+        constexpr std::chrono::milliseconds pollPeriod{ 1 };
+        std::this_thread::sleep_for(pollPeriod);
+    }
+
+    return true;
+}
+
+CRandomSequenceGenerator::TSnapshot CRandomSequenceGenerator::Snapshot()
+{
+    throw std::runtime_error("Snapshot is available for the explicitly seeded generator only");
+}
+
+uint64_t CRandomSequenceGenerator::GetBits(size_t bitsAmount)
+{
+    struct SBitCursor
+    {
+        uint64_t _instanceId = 0;
+        uint64_t _word = 0;         // bits above the left ones are zero
+        size_t _bitsLeft = 0;
+    };
+    thread_local SBitCursor cursor;
+
+    if (bitsAmount > _wordBits)
+    {
+        using namespace std::string_literals;
+        throw std::out_of_range("Requested "s + std::to_string(bitsAmount) + " bits while up to "s + std::to_string(_wordBits) + " are served"s);
+    }
+
+    if (cursor._instanceId != _instanceId)
+        cursor = { _instanceId, 0, 0 };
+
+    const auto lowBits = [](uint64_t word, size_t bits) { return bits == _wordBits ? word : word & ((uint64_t{ 1 } << bits) - 1); };
+    const auto shiftOut = [](uint64_t word, size_t bits) { return bits == _wordBits ? 0 : word >> bits; };
+
+    if (bitsAmount <= cursor._bitsLeft) [[likely]]
+    {
+        const uint64_t value = lowBits(cursor._word, bitsAmount);
+        cursor._word = shiftOut(cursor._word, bitsAmount);
+        cursor._bitsLeft -= bitsAmount;
+        return value;
+    }
+
+    const size_t wordBitsUsed = bitsAmount - cursor._bitsLeft;
+    const uint64_t word = GetValue<uint64_t>();
+    const uint64_t value = cursor._word | lowBits(word, wordBitsUsed) << cursor._bitsLeft;
+
+    cursor._word = shiftOut(word, wordBitsUsed);
+    cursor._bitsLeft = _wordBits - wordBitsUsed;
+    return value;
+}
+
+void CRandomSequenceGenerator::GetBernoulliMask(std::span<uint64_t> mask, double probability)
+{
+    if (!(probability >= 0.0 && probability <= 1.0))
+    {
+        using namespace std::string_literals;
+        throw std::out_of_range("Probability "s + std::to_string(probability) + " is out of [0, 1]"s);
+    }
+
+    static constexpr size_t precisionBits = 32;
+    const uint64_t threshold = static_cast<uint64_t>(std::llround(std::ldexp(probability, precisionBits)));
+    if (threshold == 0 || threshold == uint64_t{ 1 } << precisionBits)
+    {
+        std::fill(mask.begin(), mask.end(), threshold == 0 ? uint64_t{ 0 } : ~uint64_t{ 0 });
+        return;
+    }
+
+    // Digits are applied from the lowest set one : OR with the random word sets the half of the rest bits, AND clears it
+    const size_t lowestDigit = std::countr_zero(threshold);
+    const size_t chunkWords = std::max<size_t>(BufferSize() / sizeof(uint64_t), 1);
+
+    for (size_t begin = 0; begin < mask.size(); begin += chunkWords)
+    {
+        std::span<uint64_t> maskChunk = mask.subspan(begin, std::min(chunkWords, mask.size() - begin));
+
+        std::span<uint64_t> words = GetDataSpan<uint64_t>(maskChunk.size());
+        std::copy(words.begin(), words.end(), maskChunk.begin());
+
+        for (size_t digit = lowestDigit + 1; digit < precisionBits; ++digit)
+        {
+            words = GetDataSpan<uint64_t>(maskChunk.size());
+            if (threshold >> digit & 1)
+                for (size_t i = 0; i < maskChunk.size(); ++i)
+                    maskChunk[i] |= words[i];
+            else
+                for (size_t i = 0; i < maskChunk.size(); ++i)
+                    maskChunk[i] &= words[i];
+        }
+    }
+}
+
+bool CRandomSequenceGenerator::TryGetBytes(std::span<TByte> bytes)
+{
+    if (bytes.empty())
+        return true;
+
+    TSpan buffer = TryGetRandomBytes(bytes.size());
+    if (buffer.empty())
+        return false;
+
+    std::copy(buffer.begin(), buffer.end(), bytes.begin());
+    return true;
+}
+
+void CRandomSequenceGenerator::GetBytesAsync(std::span<TByte> bytes, FBytesReady callback)
+{
+    if (!QueueAsyncRequest(bytes, callback))
+        callback();
+}
+
+bool CRandomSequenceGenerator::QueueAsyncRequest(std::span<TByte> bytes, FBytesReady callback)
+{
+    if (!AsyncRequestsServed())
+        throw std::logic_error("Asynchronous requests aren't served by the single consumer generator");
+
+    if (bytes.size() > BufferSize())
+    {
+        using namespace std::string_literals;
+        throw std::length_error("Requested size "s + std::to_string(bytes.size()) + " is bigger that the buffer size "s + std::to_string(BufferSize()));
+    }
+
+    {
+        std::lock_guard lock(_asyncMutex);
+
+        // Earlier requests are served first
+        if (_asyncRequests.empty() && TryGetBytes(bytes))
+            return false;
+
+        _asyncRequests.push_back({ bytes, std::move(callback) });
+    }
+
+    AsyncRequestQueued();
+    return true;
+}
+
+bool CRandomSequenceGenerator::ServeAsyncRequests()
+{
+    while (true)
+    {
+        FBytesReady callback;
+        {
+            std::lock_guard lock(_asyncMutex);
+            if (_asyncRequests.empty())
+                return true;
+
+            SAsyncRequest& request = _asyncRequests.front();
+            if (!TryGetBytes(request._bytes))
+                return false;
+
+            callback = std::move(request._callback);
+            _asyncRequests.pop_front();
+        }
+
+        callback();
+    }
+}
+
+bool CRandomSequenceGenerator::AsyncRequestsPending()
+{
+    std::lock_guard lock(_asyncMutex);
+    return !_asyncRequests.empty();
+}
+
+CRandomSequenceGenerator::SWriteReport CRandomSequenceGenerator::WriteToFile(const std::filesystem::path& path, size_t bytesAmount)
+{
+    const auto startTimePoint = std::chrono::steady_clock::now();
+
+    std::unique_ptr<CMappedFile> file = CMappedFile::Create(path, bytesAmount);
+
+    // Spans are copied straight into the mapped windows while the OS writes the previous windows back and the producer
+    // refills the released buffers. The rest of the active buffer is taken first, a whole buffer request would skip it
+    for (size_t windowOffset = 0; windowOffset < bytesAmount; windowOffset += CMappedFile::_windowSize)
+    {
+        std::span<uint8_t> window = file->MapWindow(windowOffset);
+        for (size_t offset = 0; offset < window.size(); )
+        {
+            const size_t bytesLeft = ActiveBufferBytesLeft();
+            const size_t chunkSize = std::min(window.size() - offset, bytesLeft ? bytesLeft : BufferSize());
+
+            TSpan chunk = GetRandomBytes(chunkSize);
+            std::copy(chunk.begin(), chunk.end(), window.begin() + offset);
+            offset += chunkSize;
+        }
+    }
+
+    file->Close();
+
+    const auto endTimePoint = std::chrono::steady_clock::now();
+
+    SWriteReport report;
+    report._bytes = bytesAmount;
+    report._duration = std::chrono::duration_cast<SWriteReport::TTimeMeasurement>(endTimePoint - startTimePoint);
+    const double seconds = std::chrono::duration<double>(report._duration).count();
+    report._bytesPerSecond = seconds > 0 ? bytesAmount / seconds : 0;
 
+    return report;
 }
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "cpuFeatures.hpp"
+#include "include/randomSequenceTokens.hpp"
+
+// Bytes taken from the generator at once, the span is encoded before the other consumers drain the buffer
+static constexpr size_t maxChunkSize = 64 * 1024;
+static constexpr size_t uuidBytes = 16;
+static constexpr size_t vectorAlphabetSize = 64;
+
+struct SAlphabet
+{
+    std::array<char, 256> _table{};
+    uint32_t _size;
+    uint32_t _mask;
+};
+
+using FEncode = void(*)(const SAlphabet& alphabet, std::span<const uint8_t>& bytes, std::span<char>& characters) noexcept;
+using FUuids = void(*)(const uint8_t* bytes, char* characters, size_t uuids) noexcept;
+
+// Encoders consume the bytes from the front and fill the characters from the front, all of them give the same characters
+// for the same bytes, so the seeded generator gives the same tokens on any CPU
+static void ScalarEncode(const SAlphabet& alphabet, std::span<const uint8_t>& bytes, std::span<char>& characters) noexcept
+{
+    size_t byte = 0;
+    size_t character = 0;
+    while (byte < bytes.size() && character < characters.size())
+    {
+        const uint32_t index = bytes[byte++] & alphabet._mask;
+        characters[character] = alphabet._table[index];
+        character += index < alphabet._size;
+    }
+
+    bytes = bytes.subspan(byte);
+    characters = characters.subspan(character);
+}
+
+static void ScalarUuids(const uint8_t* bytes, char* characters, size_t uuids) noexcept
+{
+    for (size_t uuid = 0; uuid < uuids; ++uuid, bytes += uuidBytes)
+    {
+        for (size_t byte = 0; byte < uuidBytes; ++byte)
+        {
+            uint8_t value = bytes[byte];
+            if (byte == 6)
+                value = (value & 0x0f) | 0x40;     // version 4
+            else if (byte == 8)
+                value = (value & 0x3f) | 0x80;     // RFC 4122 variant
+
+            *characters++ = hexAlphabet[value >> 4];
+            *characters++ = hexAlphabet[value & 0x0f];
+            if (byte == 3 || byte == 5 || byte == 7 || byte == 9)
+                *characters++ = '-';
+        }
+    }
+}
+
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+// 64 entries table is looked up by 16 entries quarters, the quarter above the index overwrites the lookup of the lower one.
+// Rejected bytes are squeezed out by the scalar loop, the whole vector is stored when all the bytes are in the alphabet
+RANDOM_SEQUENCE_GENERATOR_TARGET("avx2")
+static void AVX2Encode(const SAlphabet& alphabet, std::span<const uint8_t>& bytes, std::span<char>& characters) noexcept
+{
+    constexpr size_t width = sizeof(__m256i);
+    constexpr size_t quarterSize = sizeof(__m128i);
+
+    const size_t quarters = alphabet._mask / quarterSize + 1;
+    __m256i tables[vectorAlphabetSize / quarterSize];
+    for (size_t quarter = 0; quarter < quarters; ++quarter)
+        tables[quarter] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(alphabet._table.data() + quarter * quarterSize)));
+
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(alphabet._mask));
+    const __m256i lastIndex = _mm256_set1_epi8(static_cast<char>(alphabet._size - 1));
+
+    size_t byte = 0;
+    size_t character = 0;
+    while (byte + width <= bytes.size() && character + width <= characters.size())
+    {
+        const __m256i indexes = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes.data() + byte)), mask);
+        byte += width;
+
+        __m256i encoded = _mm256_shuffle_epi8(tables[0], indexes);
+        for (size_t quarter = 1; quarter < quarters; ++quarter)
+        {
+            const __m256i inQuarter = _mm256_cmpgt_epi8(indexes, _mm256_set1_epi8(static_cast<char>(quarter * quarterSize - 1)));
+            encoded = _mm256_blendv_epi8(encoded, _mm256_shuffle_epi8(tables[quarter], indexes), inQuarter);
+        }
+
+        const uint32_t rejected = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(indexes, lastIndex)));
+        if (!rejected)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(characters.data() + character), encoded);
+            character += width;
+            continue;
+        }
+
+        alignas(width) char lane[width];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane), encoded);
+        for (size_t i = 0; i < width; ++i)
+        {
+            characters[character] = lane[i];
+            character += (rejected >> i & 1) == 0;
+        }
+    }
+
+    bytes = bytes.subspan(byte);
+    characters = characters.subspan(character);
+}
+
+// Nibbles of the 16 bytes are interleaved and looked up as the hex digits, the hyphens are inserted by two shuffles
+RANDOM_SEQUENCE_GENERATOR_TARGET("avx2")
+static void AVX2Uuids(const uint8_t* bytes, char* characters, size_t uuids) noexcept
+{
+    const __m128i hexTable = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hexAlphabet.data()));
+    const __m128i lowNibble = _mm_set1_epi8(0x0f);
+    const __m128i versionMask = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 0x0f, -1, 0x3f, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i versionBits = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0x40, 0, static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0);
+
+    // -1 leaves the place of the hyphen empty
+    const __m128i firstDigits = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, -1, 8, 9, 10, 11, -1, 12, 13);
+    const __m128i firstHyphens = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, '-', 0, 0, 0, 0, '-', 0, 0);
+    const __m128i secondFromFirstDigits = _mm_setr_epi8(14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i secondFromSecondDigits = _mm_setr_epi8(-1, -1, -1, 0, 1, 2, 3, -1, 4, 5, 6, 7, 8, 9, 10, 11);
+    const __m128i secondHyphens = _mm_setr_epi8(0, 0, '-', 0, 0, 0, 0, '-', 0, 0, 0, 0, 0, 0, 0, 0);
+
+    for (size_t uuid = 0; uuid < uuids; ++uuid, bytes += uuidBytes, characters += uuidLength)
+    {
+        const __m128i value = _mm_or_si128(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)), versionMask), versionBits);
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), lowNibble);
+        const __m128i low = _mm_and_si128(value, lowNibble);
+
+        const __m128i first = _mm_shuffle_epi8(hexTable, _mm_unpacklo_epi8(high, low));
+        const __m128i second = _mm_shuffle_epi8(hexTable, _mm_unpackhi_epi8(high, low));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(characters), _mm_or_si128(_mm_shuffle_epi8(first, firstDigits), firstHyphens));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(characters + sizeof(__m128i)),
+            _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(first, secondFromFirstDigits), _mm_shuffle_epi8(second, secondFromSecondDigits)), secondHyphens));
+
+        const int lastDigits = _mm_cvtsi128_si32(_mm_srli_si128(second, 12));
+        std::memcpy(characters + 2 * sizeof(__m128i), &lastDigits, sizeof(lastDigits));
+    }
+}
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+
+static FEncode VectorEncode() noexcept
+{
+    static const FEncode encode = []() -> FEncode
+    {
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+        if (CPUSupportsAVX2())
+            return AVX2Encode;
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+        return nullptr;
+    }();
+
+    return encode;
+}
+
+static FUuids Uuids() noexcept
+{
+    static const FUuids uuids = []() -> FUuids
+    {
+#ifdef RANDOM_SEQUENCE_GENERATOR_AVX
+        if (CPUSupportsAVX2())
+            return AVX2Uuids;
+#endif // RANDOM_SEQUENCE_GENERATOR_AVX
+        return ScalarUuids;
+    }();
+
+    return uuids;
+}
+
+void FillTokenCharacters(CRandomSequenceGenerator& generator, std::string_view alphabet, std::span<char> characters)
+{
+    using namespace std::string_literals;
+
+    SAlphabet table;
+    if (alphabet.empty() || alphabet.size() > table._table.size())
+        throw std::length_error("Alphabet size "s + std::to_string(alphabet.size()) + " is out of [1, 256]"s);
+
+    std::copy(alphabet.begin(), alphabet.end(), table._table.begin());
+    table._size = static_cast<uint32_t>(alphabet.size());
+    table._mask = static_cast<uint32_t>(std::bit_ceil(alphabet.size()) - 1);
+
+    const FEncode vectorEncode = alphabet.size() <= vectorAlphabetSize ? VectorEncode() : nullptr;
+    const size_t chunkSize = std::min(generator.BufferSize(), maxChunkSize);
+
+    while (!characters.empty())
+    {
+        // Expected amount of the bytes for the rest of the characters, the bytes left over by the rejections are dropped
+        const size_t expectedBytes = (characters.size() * (table._mask + 1) + table._size - 1) / table._size;
+        std::span<const uint8_t> bytes = generator.GetDataSpan<uint8_t>(std::min(chunkSize, expectedBytes));
+
+        if (vectorEncode)
+            vectorEncode(table, bytes, characters);
+        ScalarEncode(table, bytes, characters);
+    }
+}
+
+CTokenArena GetTokens(CRandomSequenceGenerator& generator, size_t tokensAmount, size_t tokenLength, std::string_view alphabet)
+{
+    CTokenArena tokens(tokensAmount, tokenLength);
+    FillTokenCharacters(generator, alphabet, tokens.Characters());
+    return tokens;
+}
+
+void FillUuids(CRandomSequenceGenerator& generator, std::span<char> characters)
+{
+    using namespace std::string_literals;
+
+    if (characters.size() % uuidLength)
+        throw std::length_error("Characters amount "s + std::to_string(characters.size()) + " is not a multiple of the UUID length"s);
+
+    const size_t chunkUuids = std::min(generator.BufferSize(), maxChunkSize) / uuidBytes;
+    if (chunkUuids == 0)
+        throw std::length_error("Buffer size "s + std::to_string(generator.BufferSize()) + " is less than the UUID size"s);
+
+    const FUuids uuids = Uuids();
+    for (size_t uuid = 0, uuidsAmount = characters.size() / uuidLength; uuid < uuidsAmount; )
+    {
+        const size_t chunk = std::min(chunkUuids, uuidsAmount - uuid);
+        std::span<const uint8_t> bytes = generator.GetDataSpan<uint8_t>(chunk * uuidBytes);
+        uuids(bytes.data(), characters.data() + uuid * uuidLength, chunk);
+        uuid += chunk;
+    }
+}
+
+CTokenArena GetUuids(CRandomSequenceGenerator& generator, size_t uuidsAmount)
+{
+    CTokenArena uuids(uuidsAmount, uuidLength);
+    FillUuids(generator, uuids.Characters());
+    return uuids;
+}
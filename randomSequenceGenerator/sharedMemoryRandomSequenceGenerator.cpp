@@ -0,0 +1,456 @@
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <Windows.h>
+#else // _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif // _WIN32
+
+#include "include/randomSequenceGenerator.hpp"
+#include "sharedMemoryRandomSequenceGenerator.hpp"
+
+#ifndef _WIN32
+static std::string SharedMemoryName(const std::string& name)
+{
+    return name.starts_with('/') ? name : '/' + name;
+}
+#endif // _WIN32
+
+/* static */ std::unique_ptr<CSharedMemory> CSharedMemory::Create(const std::string& name, size_t size)
+{
+    using namespace std::string_literals;
+
+    std::unique_ptr<CSharedMemory> memory(new CSharedMemory);
+    memory->_name = name;
+    memory->_size = size;
+    memory->_owner = true;
+
+#ifdef _WIN32
+    const DWORD sizeHigh = static_cast<DWORD>(static_cast<uint64_t>(size) >> 32);
+    const DWORD sizeLow = static_cast<DWORD>(size & 0xffffffff);
+    memory->_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, sizeHigh, sizeLow, name.c_str());
+    if (!memory->_handle)
+        throw std::runtime_error("Unable to create shared memory "s + name);
+
+    memory->_data = MapViewOfFile(memory->_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else // _WIN32
+    const std::string sharedName = SharedMemoryName(name);
+
+    // Segment left by a crashed publisher is replaced, attached clients keep their mapping
+    shm_unlink(sharedName.c_str());
+    // Bytes of the ring are private to the processes of the same user
+    const int fd = shm_open(sharedName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Unable to create shared memory "s + name);
+
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    {
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        memory->_data = data == MAP_FAILED ? nullptr : data;
+    }
+    close(fd);
+#endif // _WIN32
+
+    if (!memory->_data)
+        throw std::runtime_error("Unable to map shared memory "s + name);
+
+    return memory;
+}
+
+/* static */ std::unique_ptr<CSharedMemory> CSharedMemory::Open(const std::string& name)
+{
+    std::unique_ptr<CSharedMemory> memory(new CSharedMemory);
+    memory->_name = name;
+
+#ifdef _WIN32
+    memory->_handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (!memory->_handle)
+        return nullptr;
+
+    memory->_data = MapViewOfFile(memory->_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (!memory->_data)
+        return nullptr;
+
+    MEMORY_BASIC_INFORMATION info;
+    if (!VirtualQuery(memory->_data, &info, sizeof(info)))
+        return nullptr;
+    memory->_size = info.RegionSize;
+#else // _WIN32
+    const int fd = shm_open(SharedMemoryName(name).c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        memory->_size = static_cast<size_t>(info.st_size);
+        void* data = mmap(nullptr, memory->_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        memory->_data = data == MAP_FAILED ? nullptr : data;
+    }
+    close(fd);
+
+    if (!memory->_data)
+        return nullptr;
+#endif // _WIN32
+
+    return memory;
+}
+
+CSharedMemory::~CSharedMemory() noexcept
+{
+#ifdef _WIN32
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_handle)
+        CloseHandle(_handle);
+#else // _WIN32
+    if (_data)
+        munmap(_data, _size);
+    if (_owner)
+        shm_unlink(SharedMemoryName(_name).c_str());
+#endif // _WIN32
+}
+
+/* static */ size_t SSharedRing::HeaderSize() noexcept
+{
+    constexpr size_t alignment = 64;
+    return (sizeof(SSharedRing) + alignment - 1) / alignment * alignment;
+}
+
+/* static */ size_t SSharedRing::SharedSize(size_t bufferSize) noexcept
+{
+    return HeaderSize() + bufferSize * _buffersAmount;
+}
+
+/* static */ int64_t SSharedRing::Now() noexcept
+{
+    // System clock is shared by all processes of the host
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint8_t* SSharedRing::Buffer(size_t bufferNum) noexcept
+{
+    assert(bufferNum < _buffersAmount);
+    return reinterpret_cast<uint8_t*>(this) + HeaderSize() + bufferNum * _bufferSize;
+}
+
+CSharedMemoryRandomSequencePublisher::CSharedMemoryRandomSequencePublisher(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType, FHealthTestFailed healthTestFailedCallback) :
+    _generator(CRandomSequenceGenerator::Make(memorySizeInBytes, decreaseThreadPriorityCallback, generatorType, healthTestFailedCallback)),
+    _sharedMemory(CSharedMemory::Create(sharedName, SSharedRing::SharedSize(memorySizeInBytes)))
+{
+    _ring = new (_sharedMemory->Data()) SSharedRing;
+
+    _ring->_bufferSize = memorySizeInBytes;
+    _ring->_publisherAlive = true;
+    _ring->_heartbeat = SSharedRing::Now();
+    _ring->_generateNs = 0;
+    _ring->_storeNs = 0;
+    _ring->_activeBuffer = 0;
+    for (SSharedRing::SSlot& slot : _ring->_slot)
+    {
+        slot._reserved = memorySizeInBytes;
+        slot._released = memorySizeInBytes;
+    }
+
+    _ring->_magic.store(SSharedRing::_magicValue, std::memory_order_release);
+
+    _publishThread = std::thread([this]() { Publish(); });
+}
+
+CSharedMemoryRandomSequencePublisher::~CSharedMemoryRandomSequencePublisher() noexcept
+{
+    _terminate = true;
+    _publishThread.join();
+
+    _ring->_publisherAlive = false;
+}
+
+void CSharedMemoryRandomSequencePublisher::Publish()
+{
+    const size_t bufferSize = _ring->_bufferSize;
+
+    while (!_terminate)
+    {
+        _ring->_heartbeat.store(SSharedRing::Now(), std::memory_order_relaxed);
+
+        bool published = false;
+        for (size_t i = 0; i < SSharedRing::_buffersAmount && _generator->ReadyToWork() && !_terminate; ++i)
+        {
+            // Client that has reserved the last bytes may still be copying them out
+            SSharedRing::SSlot& slot = _ring->_slot[i];
+            if (slot._released.load(std::memory_order_acquire) < bufferSize)
+                continue;
+
+            std::span<uint8_t> bytes = _generator->GetDataSpan<uint8_t>(bufferSize);
+
+            const auto startTimePoint = std::chrono::steady_clock::now();
+            std::memcpy(_ring->Buffer(i), bytes.data(), bufferSize);
+            const auto endTimePoint = std::chrono::steady_clock::now();
+
+            _ring->_generateNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(_generator->Statistics()._generate).count(), std::memory_order_relaxed);
+            _ring->_storeNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(endTimePoint - startTimePoint).count(), std::memory_order_relaxed);
+
+            slot._released.store(0, std::memory_order_relaxed);
+            slot._reserved.store(0, std::memory_order_release);
+            published = true;
+        }
+
+        if (!published)
+        {
+            constexpr std::chrono::microseconds waitForConsuming{ 100 };
+            std::this_thread::sleep_for(waitForConsuming);
+        }
+    }
+}
+
+CRandomSequenceGenerator::SStatistics CSharedMemoryRandomSequencePublisher::Statistics() const noexcept
+{
+    SStatistics stat;
+    stat._generate = SStatistics::TTimeMeasurement{ _ring->_generateNs.load(std::memory_order_relaxed) };
+    stat._store = SStatistics::TTimeMeasurement{ _ring->_storeNs.load(std::memory_order_relaxed) };
+    stat._bufSize = _ring->_bufferSize;
+    return stat;
+}
+
+CSharedMemoryRandomSequenceGenerator::CSharedMemoryRandomSequenceGenerator(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback) :
+    CRandomSequenceGenerator(memorySizeInBytes), _decreaseThreadPriorityCallback(decreaseThreadPriorityCallback), _healthTestFailedCallback(healthTestFailedCallback)
+{
+    _sharedMemory = CSharedMemory::Open(sharedName);
+
+    if (_sharedMemory && _sharedMemory->Size() >= SSharedRing::HeaderSize())
+    {
+        SSharedRing* ring = static_cast<SSharedRing*>(_sharedMemory->Data());
+        if (ring->_magic.load(std::memory_order_acquire) == SSharedRing::_magicValue &&
+            ring->_bufferSize == memorySizeInBytes &&
+            _sharedMemory->Size() >= SSharedRing::SharedSize(memorySizeInBytes))
+        {
+            _ring = ring;
+        }
+    }
+
+    if (!_ring || !PublisherAlive())
+        SwitchToFallback();
+    else
+        _localBuffer.resize(2 * memorySizeInBytes);
+}
+
+CSharedMemoryRandomSequenceGenerator::~CSharedMemoryRandomSequenceGenerator() noexcept
+{
+    {
+        std::lock_guard lock(_asyncThreadMutex);
+        _terminateAsyncThread = true;
+    }
+    _asyncThreadCondVar.notify_one();
+
+    if (_asyncThread.joinable())
+        _asyncThread.join();
+}
+
+bool CSharedMemoryRandomSequenceGenerator::PublisherAlive() const noexcept
+{
+    const int64_t heartbeatAge = SSharedRing::Now() - _ring->_heartbeat.load(std::memory_order_relaxed);
+    return _ring->_publisherAlive && heartbeatAge < std::chrono::duration_cast<std::chrono::nanoseconds>(_publisherTimeout).count();
+}
+
+// Client dead between the reservation and the release leaves the slot exhausted and never refilled, the ring can't go
+// past it while the publisher is still alive
+bool CSharedMemoryRandomSequenceGenerator::RingStalled() noexcept
+{
+    const SSharedRing::SSlot& slot = _ring->_slot[_ring->_activeBuffer.load(std::memory_order_acquire)];
+    if (slot._reserved.load(std::memory_order_relaxed) < BufferSize() || slot._released.load(std::memory_order_acquire) >= BufferSize())
+    {
+        _stalledSince.store(0, std::memory_order_relaxed);
+        return false;
+    }
+
+    const int64_t now = SSharedRing::Now();
+    int64_t stalledSince = 0;
+    if (_stalledSince.compare_exchange_strong(stalledSince, now, std::memory_order_relaxed))
+        return false;
+
+    return now - stalledSince >= std::chrono::duration_cast<std::chrono::nanoseconds>(_stalledSlotTimeout).count();
+}
+
+void CSharedMemoryRandomSequenceGenerator::SwitchToFallback()
+{
+    std::call_once(_fallbackOnce, [this]()
+    {
+        _fallbackGenerator = CRandomSequenceGenerator::Make(BufferSize(), _decreaseThreadPriorityCallback, CPU_GENERATOR, _healthTestFailedCallback);
+        _useFallback.store(true, std::memory_order_release);
+    });
+}
+
+bool CSharedMemoryRandomSequenceGenerator::ReadyToWork() const noexcept
+{
+    if (_useFallback.load(std::memory_order_acquire))
+        return _fallbackGenerator->ReadyToWork();
+
+    for (const SSharedRing::SSlot& slot : _ring->_slot)
+        if (slot._reserved.load(std::memory_order_relaxed) < BufferSize())
+            return true;
+
+    return false;
+}
+
+CRandomSequenceGenerator::SStatistics CSharedMemoryRandomSequenceGenerator::Statistics() const noexcept
+{
+    if (_useFallback.load(std::memory_order_acquire))
+        return _fallbackGenerator->Statistics();
+
+    SStatistics stat;
+    stat._generate = SStatistics::TTimeMeasurement{ _ring->_generateNs.load(std::memory_order_relaxed) };
+    stat._store = SStatistics::TTimeMeasurement{ _ring->_storeNs.load(std::memory_order_relaxed) };
+    stat._bufSize = BufferSize();
+    return stat;
+}
+
+CRandomSequenceGenerator::TSpan CSharedMemoryRandomSequenceGenerator::TakeBytes(size_t size)
+{
+    while (true)
+    {
+        const size_t activeBuffer = _ring->_activeBuffer.load(std::memory_order_acquire);
+        SSharedRing::SSlot& slot = _ring->_slot[activeBuffer];
+
+        // Active buffer is waiting for the publisher
+        if (slot._reserved.load(std::memory_order_relaxed) >= BufferSize())
+            return TSpan();
+
+        const size_t prevConsumed = slot._reserved.fetch_add(size, std::memory_order_acq_rel);
+        const size_t newConsumed = prevConsumed + size;
+
+        // The client that exhausts the buffer moves the ring forward, the publisher refills the buffer then
+        if (newConsumed >= BufferSize())
+        {
+            size_t expectedBuffer = activeBuffer;
+            _ring->_activeBuffer.compare_exchange_strong(expectedBuffer, (activeBuffer + 1) % SSharedRing::_buffersAmount, std::memory_order_acq_rel);
+        }
+
+        if (newConsumed > BufferSize())
+        {
+            // Tail of the buffer too short for the request is skipped, it is released by the client that has overrun it
+            if (prevConsumed < BufferSize())
+                slot._released.fetch_add(BufferSize() - prevConsumed, std::memory_order_release);
+            continue;
+        }
+
+        TByte* data;
+        {
+            std::lock_guard lock(_localMutex);
+            if (_localOffset + size > _localBuffer.size())
+                _localOffset = 0;
+
+            data = _localBuffer.data() + _localOffset;
+            _localOffset += size;
+        }
+
+        std::memcpy(data, _ring->Buffer(activeBuffer) + prevConsumed, size);
+        slot._released.fetch_add(size, std::memory_order_release);
+
+        return TSpan(data, size);
+    }
+}
+
+CRandomSequenceGenerator::TSpan CSharedMemoryRandomSequenceGenerator::GetRandomBytes(size_t size)
+{
+    if (size > BufferSize())
+    {
+        using namespace std::string_literals;
+        throw std::length_error("Requested size "s + std::to_string(size) + " is bigger that the buffer size "s + std::to_string(BufferSize()));
+    }
+
+    if (size == 0)
+    {
+        assert(false);
+        return TSpan();
+    }
+
+    while (true)
+    {
+        if (_useFallback.load(std::memory_order_acquire))
+            return _fallbackGenerator->GetDataSpan<TByte>(size);
+
+        TSpan bytes = TakeBytes(size);
+        if (!bytes.empty())
+            return bytes;
+
+        if (!PublisherAlive() || RingStalled())
+        {
+            SwitchToFallback();
+            continue;
+        }
+
+        constexpr std::chrono::microseconds waitForFilling{ 100 };
+        std::this_thread::sleep_for(waitForFilling);
+    }
+}
+
+CRandomSequenceGenerator::TSpan CSharedMemoryRandomSequenceGenerator::TryGetRandomBytes(size_t size)
+{
+    if (size > BufferSize())
+    {
+        using namespace std::string_literals;
+        throw std::length_error("Requested size "s + std::to_string(size) + " is bigger that the buffer size "s + std::to_string(BufferSize()));
+    }
+
+    if (size == 0)
+    {
+        assert(false);
+        return TSpan();
+    }
+
+    if (!_useFallback.load(std::memory_order_acquire))
+    {
+        TSpan bytes = TakeBytes(size);
+        if (!bytes.empty() || (PublisherAlive() && !RingStalled()))
+            return bytes;
+
+        SwitchToFallback();
+    }
+
+    return _fallbackGenerator->TryGetDataSpan<TByte>(size);
+}
+
+void CSharedMemoryRandomSequenceGenerator::AsyncRequestQueued()
+{
+    std::call_once(_asyncThreadOnce, [this]()
+    {
+        _asyncThread = std::thread([this]() { ServeAsyncRequestsThread(); });
+    });
+
+    {
+        std::lock_guard lock(_asyncThreadMutex);
+        _asyncRequestQueued = true;
+    }
+    _asyncThreadCondVar.notify_one();
+}
+
+void CSharedMemoryRandomSequenceGenerator::ServeAsyncRequestsThread()
+{
+    while (true)
+    {
+        {
+            std::unique_lock lock(_asyncThreadMutex);
+            _asyncThreadCondVar.wait(lock, [this] { return _asyncRequestQueued || _terminateAsyncThread; });
+            if (_terminateAsyncThread)
+                return;
+            _asyncRequestQueued = false;
+        }
+
+        // Publisher doesn't notify the clients, the ring is polled like the blocking path does
+        while (!ServeAsyncRequests() && !_terminateAsyncThread)
+        {
+            constexpr std::chrono::microseconds waitForFilling{ 100 };
+            std::this_thread::sleep_for(waitForFilling);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_SHARED_MEMORY_IMPLEMENTATION_
+#define RANDOM_SEQUENCE_GENERATOR_SHARED_MEMORY_IMPLEMENTATION_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "include/randomSequenceGenerator.hpp"
+
+class CSharedMemory
+{
+public:
+    static std::unique_ptr<CSharedMemory> Create(const std::string& name, size_t size);
+    static std::unique_ptr<CSharedMemory> Open(const std::string& name);
+
+    ~CSharedMemory() noexcept;
+
+    void* Data() const noexcept { return _data; }
+    size_t Size() const noexcept { return _size; }
+
+private:
+    CSharedMemory() = default;
+
+    std::string _name;
+    void* _data = nullptr;
+    size_t _size = 0;
+    bool _owner = false;
+#ifdef _WIN32
+    void* _handle = nullptr;
+#endif // _WIN32
+};
+
+// Shared memory layout : SSharedRing header followed by the buffers. Every buffer has its own reservation cursor,
+// the buffer is exhausted once the cursor reaches the buffer size. Clients release the reserved bytes after copying them out,
+// the publisher refills the buffer once all its bytes are released. The buffer a dead client has never released stops the ring,
+// the clients switch to their local generators then
+struct SSharedRing
+{
+    static constexpr uint64_t _magicValue = 0x52534753484d5632;       // "RSGSHMV2"
+    static constexpr size_t _buffersAmount = 4;
+
+    struct alignas(64) SSlot
+    {
+        std::atomic<size_t> _reserved;
+        std::atomic<size_t> _released;
+    };
+
+    std::atomic<uint64_t> _magic;
+    size_t _bufferSize;
+    std::atomic<bool> _publisherAlive;
+    std::atomic<int64_t> _heartbeat;
+    std::atomic<int64_t> _generateNs;
+    std::atomic<int64_t> _storeNs;
+    alignas(64) std::atomic<size_t> _activeBuffer;
+    std::array<SSlot, _buffersAmount> _slot;
+
+    static size_t HeaderSize() noexcept;
+    static size_t SharedSize(size_t bufferSize) noexcept;
+    static int64_t Now() noexcept;
+
+    uint8_t* Buffer(size_t bufferNum) noexcept;
+};
+
+static_assert(std::atomic<size_t>::is_always_lock_free && std::atomic<int64_t>::is_always_lock_free, "Shared memory ring requires address-free atomics");
+
+class CSharedMemoryRandomSequencePublisher : public CRandomSequencePublisher
+{
+public:
+    CSharedMemoryRandomSequencePublisher(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, EGeneratorType generatorType, FHealthTestFailed healthTestFailedCallback);
+    ~CSharedMemoryRandomSequencePublisher() noexcept override;
+
+    SStatistics Statistics() const noexcept override;
+
+private:
+    std::unique_ptr<CRandomSequenceGenerator> _generator;
+    std::unique_ptr<CSharedMemory> _sharedMemory;
+    SSharedRing* _ring;
+    std::atomic<bool> _terminate = false;
+    std::thread _publishThread;
+
+    void Publish();
+};
+
+class CSharedMemoryRandomSequenceGenerator : public CRandomSequenceGenerator
+{
+public:
+    CSharedMemoryRandomSequenceGenerator(const std::string& sharedName, size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback);
+    ~CSharedMemoryRandomSequenceGenerator() noexcept override;
+
+    bool ReadyToWork() const noexcept override;
+    SStatistics Statistics() const noexcept override;
+
+private:
+    // Publisher may be blocked by a full buffer refill of its own generator before the next heartbeat
+    static constexpr std::chrono::milliseconds _publisherTimeout{ 5000 };
+    // Releasing client copies the reserved bytes only, the longer release is left by a dead client
+    static constexpr std::chrono::milliseconds _stalledSlotTimeout{ 1000 };
+
+    std::unique_ptr<CSharedMemory> _sharedMemory;
+    SSharedRing* _ring = nullptr;
+    std::unique_ptr<CRandomSequenceGenerator> _fallbackGenerator;
+    std::once_flag _fallbackOnce;
+    std::atomic<bool> _useFallback = false;
+    std::atomic<int64_t> _stalledSince = 0;
+    FDecreaseThreadPriority _decreaseThreadPriorityCallback;
+    FHealthTestFailed _healthTestFailedCallback;
+    std::thread _asyncThread;
+    std::once_flag _asyncThreadOnce;
+    std::mutex _asyncThreadMutex;
+    std::condition_variable _asyncThreadCondVar;
+    bool _asyncRequestQueued = false;
+    std::atomic<bool> _terminateAsyncThread = false;
+    // Bytes copied out of the shared ring are served from the local ring of two buffers, a span stays valid until it wraps around
+    TBuffer _localBuffer;
+    size_t _localOffset = 0;
+    std::mutex _localMutex;
+
+    TSpan GetRandomBytes(size_t size) override;
+    TSpan TryGetRandomBytes(size_t size) override;
+    void AsyncRequestQueued() override;
+    TSpan TakeBytes(size_t size);
+    bool PublisherAlive() const noexcept;
+    bool RingStalled() noexcept;
+    void SwitchToFallback();
+    void ServeAsyncRequestsThread();
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_SHARED_MEMORY_IMPLEMENTATION_
@@ -0,0 +1,119 @@
+
+#include <iostream>
+#include <stdexcept>
+
+#include "warmUpRandomSequenceGenerator.hpp"
+#include "CPUrandomSequenceGenerator.hpp"
+#include "GPUrandomSequenceGenerator.hpp"
+
+CWarmUpRandomSequenceGenerator::CWarmUpRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering) :
+    CRandomSequenceGenerator(memorySizeInBytes),
+    _cpuGenerator(std::make_unique<CCPURandomSequenceGenerator>(memorySizeInBytes, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering, std::nullopt)),
+    _activeGenerator(_cpuGenerator.get())
+{
+    _warmUpThread = std::thread([this, decreaseThreadPriorityCallback, healthTestFailedCallback, buffering]()
+    {
+        WarmUp(decreaseThreadPriorityCallback, healthTestFailedCallback, buffering);
+    });
+}
+
+CWarmUpRandomSequenceGenerator::~CWarmUpRandomSequenceGenerator() noexcept
+{
+    // Program build isn't interrupted, the destruction waits for it
+    _terminate = true;
+    _warmUpThread.join();
+
+    {
+        std::lock_guard lock(_asyncThreadMutex);
+        _terminateAsyncThread = true;
+    }
+    _asyncThreadCondVar.notify_one();
+
+    if (_asyncThread.joinable())
+        _asyncThread.join();
+}
+
+void CWarmUpRandomSequenceGenerator::WarmUp(FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering)
+{
+    decreaseThreadPriorityCallback();
+
+    try
+    {
+        if (!CGPURandomSequenceGenerator::CheckOpenCLdevicesAvailability())
+            return;
+
+        _gpuGenerator = std::make_unique<CGPURandomSequenceGenerator>(BufferSize(), decreaseThreadPriorityCallback, healthTestFailedCallback, buffering);
+
+        while (!_gpuGenerator->WaitUntilReady(_handoverPollPeriod))
+            if (_terminate)
+                return;
+    }
+    catch (const std::exception& err)
+    {
+        std::cerr << "GPU generator is not available, CPU generator is used: " << err.what() << std::endl;
+        return;
+    }
+
+    // Consumers in the middle of the CPU request finish it, the following requests go to the GPU generator
+    _activeGenerator.store(_gpuGenerator.get(), std::memory_order_release);
+}
+
+bool CWarmUpRandomSequenceGenerator::ReadyToWork() const noexcept
+{
+    return ActiveGenerator().ReadyToWork();
+}
+
+bool CWarmUpRandomSequenceGenerator::WaitUntilReady(std::chrono::milliseconds timeout)
+{
+    return ActiveGenerator().WaitUntilReady(timeout);
+}
+
+CRandomSequenceGenerator::SStatistics CWarmUpRandomSequenceGenerator::Statistics() const noexcept
+{
+    return ActiveGenerator().Statistics();
+}
+
+CRandomSequenceGenerator::TSpan CWarmUpRandomSequenceGenerator::GetRandomBytes(size_t size)
+{
+    return ActiveGenerator().GetDataSpan<TByte>(size);
+}
+
+CRandomSequenceGenerator::TSpan CWarmUpRandomSequenceGenerator::TryGetRandomBytes(size_t size)
+{
+    return ActiveGenerator().TryGetDataSpan<TByte>(size);
+}
+
+void CWarmUpRandomSequenceGenerator::AsyncRequestQueued()
+{
+    std::call_once(_asyncThreadOnce, [this]()
+    {
+        _asyncThread = std::thread([this]() { ServeAsyncRequestsThread(); });
+    });
+
+    {
+        std::lock_guard lock(_asyncThreadMutex);
+        _asyncRequestQueued = true;
+    }
+    _asyncThreadCondVar.notify_one();
+}
+
+void CWarmUpRandomSequenceGenerator::ServeAsyncRequestsThread()
+{
+    while (true)
+    {
+        {
+            std::unique_lock lock(_asyncThreadMutex);
+            _asyncThreadCondVar.wait(lock, [this] { return _asyncRequestQueued || _terminateAsyncThread; });
+            if (_terminateAsyncThread)
+                return;
+            _asyncRequestQueued = false;
+        }
+
+        // Refills of the inner generators don't notify the wrapper, the requests are retried like the shared memory client does
+        while (!ServeAsyncRequests() && !_terminateAsyncThread)
+        {
+            constexpr std::chrono::microseconds waitForFilling{ 100 };
+            std::this_thread::sleep_for(waitForFilling);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef RANDOM_SEQUENCE_GENERATOR_WARM_UP_IMPLEMENTATION_
+#define RANDOM_SEQUENCE_GENERATOR_WARM_UP_IMPLEMENTATION_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "include/randomSequenceGenerator.hpp"
+
+// Requests are served by the CPU generator while the GPU generator discovers the device, builds the program and fills its
+// first buffer on the background thread. The requests are handed over to the GPU generator at once then, the CPU generator
+// is kept until the destruction since the spans it has handed out must stay valid
+class CWarmUpRandomSequenceGenerator : public CRandomSequenceGenerator
+{
+public:
+    CWarmUpRandomSequenceGenerator(size_t memorySizeInBytes, FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering);
+    ~CWarmUpRandomSequenceGenerator() noexcept override;
+
+    bool ReadyToWork() const noexcept override;
+    bool WaitUntilReady(std::chrono::milliseconds timeout) override;
+    SStatistics Statistics() const noexcept override;
+
+private:
+    // GPU generator may take long to build and tune the kernel, the warm-up thread checks for the termination meanwhile
+    static constexpr std::chrono::milliseconds _handoverPollPeriod{ 100 };
+
+    std::unique_ptr<CRandomSequenceGenerator> _cpuGenerator;
+    std::unique_ptr<CRandomSequenceGenerator> _gpuGenerator;
+    std::atomic<CRandomSequenceGenerator*> _activeGenerator;
+    std::thread _warmUpThread;
+    std::atomic<bool> _terminate = false;
+    std::thread _asyncThread;
+    std::once_flag _asyncThreadOnce;
+    std::mutex _asyncThreadMutex;
+    std::condition_variable _asyncThreadCondVar;
+    bool _asyncRequestQueued = false;
+    std::atomic<bool> _terminateAsyncThread = false;
+
+    CRandomSequenceGenerator& ActiveGenerator() noexcept { return *_activeGenerator.load(std::memory_order_acquire); }
+    const CRandomSequenceGenerator& ActiveGenerator() const noexcept { return *_activeGenerator.load(std::memory_order_acquire); }
+    void WarmUp(FDecreaseThreadPriority decreaseThreadPriorityCallback, FHealthTestFailed healthTestFailedCallback, const SBuffering& buffering);
+    TSpan GetRandomBytes(size_t size) override;
+    TSpan TryGetRandomBytes(size_t size) override;
+    void AsyncRequestQueued() override;
+    void ServeAsyncRequestsThread();
+};
+
+#endif // RANDOM_SEQUENCE_GENERATOR_WARM_UP_IMPLEMENTATION_
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#else // _WIN32
+    #include <cerrno>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <sys/ioctl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #ifdef __linux__
+        #include <poll.h>
+        #include <sys/uio.h>
+    #endif // __linux__
+#endif // _WIN32
+
+#include <randomSequenceGenerator.hpp>
+
+struct SOptions
+{
+    std::string _backend = "auto";
+    std::optional<size_t> _bytes;       // unlimited when empty
+    size_t _bufferSize = 16ULL << 20;
+};
+
+static size_t ParseSize(const std::string& value)
+{
+    size_t pos = 0;
+    size_t size = std::stoull(value, &pos);
+    if (pos < value.size())
+    {
+        switch (value[pos])
+        {
+        case 'K': case 'k': size <<= 10; break;
+        case 'M': case 'm': size <<= 20; break;
+        case 'G': case 'g': size <<= 30; break;
+        default: throw std::invalid_argument("Unknown size suffix in " + value);
+        }
+    }
+    return size;
+}
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: randomStream [--backend cpu|gpu|auto|chacha8|chacha12|chacha20|shared:<name>] [--bytes <size>[K|M|G]|unlimited] [--buffer <size>[K|M|G]]" << std::endl;
+}
+
+static bool ParseOptions(int argc, char* argv[], SOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc)
+            return false;
+
+        const std::string value = argv[++i];
+        if (arg == "--backend")
+            options._backend = value;
+        else if (arg == "--bytes")
+            options._bytes = value == "unlimited" ? std::nullopt : std::optional<size_t>(ParseSize(value));
+        else if (arg == "--buffer")
+            options._bufferSize = ParseSize(value);
+        else
+            return false;
+    }
+
+    return true;
+}
+
+static std::unique_ptr<CRandomSequenceGenerator> MakeGenerator(const SOptions& options)
+{
+    auto decreaseThreadPriority = []() {};
+    const std::string sharedPrefix = "shared:";
+
+    // Ring grows while the reader outpaces the refill of a single buffer
+    CRandomSequenceGenerator::SBuffering buffering;
+    buffering._maxBuffers = 8;
+
+    if (options._backend == "cpu")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR, nullptr, buffering);
+    else if (options._backend == "gpu")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::GPU_GENERATOR, nullptr, buffering);
+    else if (options._backend == "auto")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::GPU_IF_POSSIBLE_GENERATOR, nullptr, buffering);
+    else if (options._backend == "chacha8")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CHACHA8_GENERATOR, nullptr, buffering);
+    else if (options._backend == "chacha12")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CHACHA12_GENERATOR, nullptr, buffering);
+    else if (options._backend == "chacha20")
+        return CRandomSequenceGenerator::Make(options._bufferSize, decreaseThreadPriority, CRandomSequenceGenerator::CHACHA20_GENERATOR, nullptr, buffering);
+    else if (options._backend.starts_with(sharedPrefix))
+        return CRandomSequenceGenerator::MakeSharedClient(options._backend.substr(sharedPrefix.size()), options._bufferSize, decreaseThreadPriority);
+    else
+        throw std::invalid_argument("Unknown backend " + options._backend);
+}
+
+// Standard output fed straight from the generator buffers. The pipe gets the pages of the buffer by vmsplice without copying them,
+// the regular file gets them from the private pipe by splice, anything else is written by write
+class CStreamOutput
+{
+public:
+    CStreamOutput()
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#else // _WIN32
+        // Gone reader is reported by EPIPE instead of killing the process before the report
+        std::signal(SIGPIPE, SIG_IGN);
+
+    #ifdef __linux__
+        struct stat status;
+        if (fstat(STDOUT_FILENO, &status) != 0)
+            return;
+
+        if (S_ISFIFO(status.st_mode))
+        {
+            _mode = EMode::VMSPLICE;
+            _pipe = STDOUT_FILENO;
+            fcntl(_pipe, F_SETPIPE_SZ, _pipeSize);
+        }
+        else if (S_ISREG(status.st_mode) && pipe(_ownPipe) == 0)
+        {
+            _mode = EMode::SPLICE;
+            _pipe = _ownPipe[1];
+            fcntl(_pipe, F_SETPIPE_SZ, _pipeSize);
+        }
+    #endif // __linux__
+#endif // _WIN32
+    }
+
+    ~CStreamOutput() noexcept
+    {
+#ifndef _WIN32
+        for (int fd : _ownPipe)
+            if (fd >= 0)
+                close(fd);
+#endif // _WIN32
+    }
+
+    CStreamOutput(const CStreamOutput&) = delete;
+    CStreamOutput& operator=(const CStreamOutput&) = delete;
+
+    const char* Mode() const noexcept
+    {
+        switch (_mode)
+        {
+        case EMode::VMSPLICE: return "vmsplice";
+        case EMode::SPLICE: return "vmsplice + splice";
+        default: return "write";
+        }
+    }
+
+    // Pages handed to the pipe stay referenced until the reader takes them, the buffer is refilled by the producer as soon as
+    // the next one is taken. The pipe is drained first, so the reader never gets the refilled bytes in place of the handed ones.
+    // Returns false once the reader has gone
+    bool WaitForDrain() const
+    {
+#ifdef __linux__
+        if (_mode != EMode::VMSPLICE)
+            return true;
+
+        int pending = 0;
+        while (ioctl(_pipe, FIONREAD, &pending) == 0 && pending > 0)
+        {
+            pollfd output{ _pipe, POLLOUT, 0 };
+            if (poll(&output, 1, 0) > 0 && (output.revents & POLLERR))
+                return false;
+
+            constexpr std::chrono::microseconds waitForReading{ 20 };
+            std::this_thread::sleep_for(waitForReading);
+        }
+#endif // __linux__
+        return true;
+    }
+
+    // Returns false once the reader has gone
+    bool Write(std::span<const uint8_t> bytes)
+    {
+#ifdef __linux__
+        while (!bytes.empty() && _mode != EMode::WRITE)
+        {
+            iovec chunk{ const_cast<uint8_t*>(bytes.data()), bytes.size() };
+            const ssize_t spliced = vmsplice(_pipe, &chunk, 1, 0);
+            if (spliced < 0 && errno == EINTR)
+                continue;
+            if (spliced < 0 && errno == EPIPE)
+                return false;
+            if (spliced <= 0)
+            {
+                // Kernel without vmsplice support for the descriptor, the rest goes by write
+                _mode = EMode::WRITE;
+                break;
+            }
+
+            if (_mode == EMode::SPLICE && !SpliceToOutput(static_cast<size_t>(spliced)))
+                return false;
+
+            bytes = bytes.subspan(static_cast<size_t>(spliced));
+        }
+#endif // __linux__
+
+        return WriteCopy(bytes);
+    }
+
+private:
+    enum class EMode { WRITE, VMSPLICE, SPLICE };
+
+    // Bytes in flight between the buffer and the reader, the drain before the next buffer waits for them
+    static constexpr int _pipeSize = 1 << 20;
+
+    EMode _mode = EMode::WRITE;
+    int _pipe = -1;
+    int _ownPipe[2] = { -1, -1 };
+
+#ifdef __linux__
+    bool SpliceToOutput(size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t moved = splice(_ownPipe[0], nullptr, STDOUT_FILENO, nullptr, size, SPLICE_F_MOVE);
+            if (moved < 0 && errno == EINTR)
+                continue;
+            if (moved <= 0)
+                return false;
+
+            size -= static_cast<size_t>(moved);
+        }
+
+        return true;
+    }
+#endif // __linux__
+
+    static bool WriteCopy(std::span<const uint8_t> bytes)
+    {
+#ifdef _WIN32
+        return std::fwrite(bytes.data(), 1, bytes.size(), stdout) == bytes.size();
+#else // _WIN32
+        while (!bytes.empty())
+        {
+            const ssize_t written = write(STDOUT_FILENO, bytes.data(), bytes.size());
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+
+            bytes = bytes.subspan(static_cast<size_t>(written));
+        }
+
+        return true;
+#endif // _WIN32
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    try
+    {
+        if (!ParseOptions(argc, argv, options))
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+    catch (const std::exception&)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    // Standard output carries the data, the report goes to the standard error
+    try
+    {
+        auto gen = MakeGenerator(options);
+        while (!gen->WaitUntilReady(std::chrono::seconds{ 1 }))
+            ;
+
+        CStreamOutput output;
+
+        // Every request takes the whole next buffer of the ring, the previous one goes to the producer for the refill
+        size_t written = 0;
+        const auto startTimePoint = std::chrono::steady_clock::now();
+        while (!options._bytes || written < *options._bytes)
+        {
+            const size_t size = options._bytes ? std::min(gen->BufferSize(), *options._bytes - written) : gen->BufferSize();
+
+            if (!output.WaitForDrain())
+                break;
+
+            std::span<uint8_t> bytes = gen->GetDataSpan<uint8_t>(size);
+            if (!output.Write(bytes))
+                break;
+
+            written += size;
+        }
+        output.WaitForDrain();
+        const auto endTimePoint = std::chrono::steady_clock::now();
+
+        const double seconds = std::chrono::duration<double>(endTimePoint - startTimePoint).count();
+        std::cerr << "* " << written << " bytes from " << options._backend << " backend in " << seconds << " s ("
+            << static_cast<size_t>(written / seconds / 1'000'000) << " MB/s, " << output.Mode() << ")" << std::endl;
+
+        return 0;
+    }
+    catch (const std::exception& err)
+    {
+        std::cerr << "*** " << err.what() << std::endl;
+        return 2;
+    }
+}
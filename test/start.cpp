@@ -5,6 +5,24 @@
 void TestSequence(CRandomSequenceGenerator::EGeneratorType genType);
 void TestGeneralAbilities();
 void TestStaticGeneration();
+void TestWriteToFile();
+void TestSharedMemory();
+void TestHealthTests();
+void TestTemplateGenerator();
+void TestAsyncRequests();
+void TestAdaptiveBuffering();
+void TestChaChaGenerator();
+void TestShuffleAndSampling();
+void TestBits();
+void TestAliasSampler();
+void TestSeededGenerator();
+void TestProgressivePublishing();
+void TestGpuWarmUp();
+void TestKernelConfigCache();
+void TestContainerReuse();
+void TestTokens();
+void TestGeneratorShutdown();
+void TestProducerFailover();
 
 int main(int argc, char* argv[])
 {
@@ -18,6 +36,60 @@ int main(int argc, char* argv[])
         std::cout << "* Static generation" << std::endl;
         TestStaticGeneration();
 
+        std::cout << "* File writing" << std::endl;
+        TestWriteToFile();
+
+        std::cout << "* Shared memory" << std::endl;
+        TestSharedMemory();
+
+        std::cout << "* Health tests" << std::endl;
+        TestHealthTests();
+
+        std::cout << "* Compile time configured generator" << std::endl;
+        TestTemplateGenerator();
+
+        std::cout << "* Asynchronous requests" << std::endl;
+        TestAsyncRequests();
+
+        std::cout << "* Adaptive buffering" << std::endl;
+        TestAdaptiveBuffering();
+
+        std::cout << "* Cryptographically secure generator" << std::endl;
+        TestChaChaGenerator();
+
+        std::cout << "* Shuffle and sampling" << std::endl;
+        TestShuffleAndSampling();
+
+        std::cout << "* Bits" << std::endl;
+        TestBits();
+
+        std::cout << "* Weighted sampling" << std::endl;
+        TestAliasSampler();
+
+        std::cout << "* Seeded generation" << std::endl;
+        TestSeededGenerator();
+
+        std::cout << "* Progressive publishing" << std::endl;
+        TestProgressivePublishing();
+
+        std::cout << "* GPU warm-up" << std::endl;
+        TestGpuWarmUp();
+
+        std::cout << "* GPU kernel tuning" << std::endl;
+        TestKernelConfigCache();
+
+        std::cout << "* Container reuse" << std::endl;
+        TestContainerReuse();
+
+        std::cout << "* Tokens" << std::endl;
+        TestTokens();
+
+        std::cout << "* Shutdown" << std::endl;
+        TestGeneratorShutdown();
+
+        std::cout << "* Producer failure" << std::endl;
+        TestProducerFailover();
+
         std::cout << "* GPU generator : " << std::endl;
         TestSequence(CRandomSequenceGenerator::GPU_GENERATOR);
 
@@ -1,11 +1,22 @@
 
+#include <algorithm>
 #include <cassert>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <bitset>
 #include <chrono>
+#include <cmath>
+#include <coroutine>
 #include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
 #include <queue>
 #include <set>
 #include <source_location>
@@ -15,6 +26,13 @@
 #include <vector>
 
 #include <randomSequenceGenerator.hpp>
+#include <randomSequenceGeneratorTemplate.hpp>
+#include <chachaEngine.hpp>
+#include <randomSequenceAlgorithms.hpp>
+#include <randomSequenceTokens.hpp>
+#include <kernelConfigCache.hpp>
+
+#include "../randomSequenceGenerator/sharedMemoryRandomSequenceGenerator.hpp"
 
 #ifdef _WIN32
     #include <Windows.h>
@@ -39,8 +57,9 @@ void DecreaseThreadPriority()
 
 void WaitForInit(CRandomSequenceGenerator* gen)
 {
-    while (!gen->ReadyToWork())
-        std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+    constexpr std::chrono::seconds initTimeout{ 60 };
+    if (!gen->WaitUntilReady(initTimeout))
+        OutputError();
 }
 
 void TestGeneralAbilities()
@@ -190,10 +209,11 @@ void TestSequence(CRandomSequenceGenerator::EGeneratorType genType, size_t bufSi
         }
     }
 
-    bool allAreDiff = true;
-    for (size_t i = 0; i < buffers.size() - 1; ++i)
-        for (size_t j = i + 1; j < buffers.size(); ++j)
-            allAreDiff &= buffers[i] != buffers[j];
+    std::vector<const std::vector<uint8_t>*> sortedBuffers;
+    for (const auto& buf : buffers)
+        sortedBuffers.push_back(&buf);
+    std::sort(sortedBuffers.begin(), sortedBuffers.end(), [](auto* left, auto* right) { return *left < *right; });
+    const bool allAreDiff = std::adjacent_find(sortedBuffers.begin(), sortedBuffers.end(), [](auto* left, auto* right) { return *left == *right; }) == sortedBuffers.end();
 
     if (!allAreDiff)
         OutputError();
@@ -278,6 +298,1430 @@ void TestStaticGeneration()
     if(bytes == bytesFromValues)
         OutputError();
 
+    std::array<uint8_t, 13> storedBytes{};
+    CRandomSequenceGenerator::GetBytesOnce(storedBytes);
+    if (std::all_of(storedBytes.begin(), storedBytes.end(), [](uint8_t byte) { return byte == 0; }))
+        OutputError();
+
+    std::array<uint64_t, 7> storedValues{};
+    CRandomSequenceGenerator::GetDataOnce<uint64_t>(storedValues);
+    if (std::all_of(storedValues.begin(), storedValues.end(), [](uint64_t value) { return value == 0; }))
+        OutputError();
+
+    std::vector<uint8_t> otherThreadBytes;
+    std::thread([&otherThreadBytes, &bytes] { otherThreadBytes = CRandomSequenceGenerator::GetBytesOnce(bytes.size()); }).join();
+    if (otherThreadBytes.size() != bytes.size() || otherThreadBytes == bytes)
+        OutputError();
+
+    std::cout << "OK" << std::endl;
+
+}
+
+void TestWriteToFile()
+{
+    std::cout << "- Test writing to file: ";
+
+    auto gen = CRandomSequenceGenerator::Make(100'000, DecreaseThreadPriority);
+    WaitForInit(gen.get());
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "randomSequenceGenerator.bin";
+    const size_t bytesAmount = 1'234'567;
+
+    CRandomSequenceGenerator::SWriteReport report = gen->WriteToFile(path, bytesAmount);
+
+    if (report._bytes != bytesAmount || std::filesystem::file_size(path) != bytesAmount)
+        OutputError();
+
+    // Every chunk lands in the mapped window, the window left unwritten reads back as zeros
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> content(bytesAmount);
+    file.read(content.data(), content.size());
+    const size_t zeros = std::count(content.begin(), content.end(), '\0');
+    if (!file || zeros > bytesAmount / 128)
+        OutputError();
+    file.close();
+
+    std::filesystem::remove(path);
+
+    std::cout << static_cast<size_t>(report._bytesPerSecond / 1'000'000) << " MB/s OK" << std::endl;
+}
+
+void TestSharedMemory()
+{
+    std::cout << "- Test shared memory ring: ";
+
+    {
+        auto publisher = CRandomSequencePublisher::Make("randomSequenceGeneratorTest", 100'000, DecreaseThreadPriority);
+        auto client = CRandomSequenceGenerator::MakeSharedClient("randomSequenceGeneratorTest", 100'000, DecreaseThreadPriority);
+        WaitForInit(client.get());
+
+        std::vector<uint8_t> first = client->GetValues<std::vector<uint8_t>>(1000);
+        std::vector<uint8_t> second = client->GetValues<std::vector<uint8_t>>(1000);
+        if (first == second)
+            OutputError();
+    }
+
+    {
+        // Buffers are refilled only after every client has copied its bytes out, no bytes are served twice.
+        // Every client stands for a separate process
+        const size_t bufferSize = 4096;
+        auto publisher = CRandomSequencePublisher::Make("randomSequenceGeneratorTestRefill", bufferSize, DecreaseThreadPriority);
+        std::vector<std::unique_ptr<CRandomSequenceGenerator>> clients;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            clients.push_back(CRandomSequenceGenerator::MakeSharedClient("randomSequenceGeneratorTestRefill", bufferSize, DecreaseThreadPriority));
+            WaitForInit(clients.back().get());
+        }
+
+        const size_t valuesPerClient = 50'000;
+        std::vector<std::vector<uint64_t>> values(clients.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < clients.size(); ++i)
+        {
+            threads.emplace_back([&client = *clients[i], &clientValues = values[i], valuesPerClient]()
+            {
+                for (size_t j = 0; j < valuesPerClient; ++j)
+                    clientValues.push_back(client.GetValue<uint64_t>());
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+
+        std::set<uint64_t> distinct;
+        for (const std::vector<uint64_t>& clientValues : values)
+            distinct.insert(clientValues.begin(), clientValues.end());
+        if (distinct.size() != clients.size() * valuesPerClient)
+            OutputError();
+    }
+
+    {
+        // Client process killed between its reservation and the release leaves the bytes reserved for good, the publisher is
+        // still alive and the other clients go on with their local generators
+        const size_t bufferSize = 4096;
+        auto publisher = CRandomSequencePublisher::Make("randomSequenceGeneratorTestStalled", bufferSize, DecreaseThreadPriority);
+        auto client = CRandomSequenceGenerator::MakeSharedClient("randomSequenceGeneratorTestStalled", bufferSize, DecreaseThreadPriority);
+        WaitForInit(client.get());
+
+        auto sharedMemory = CSharedMemory::Open("randomSequenceGeneratorTestStalled");
+        SSharedRing* ring = static_cast<SSharedRing*>(sharedMemory->Data());
+        ring->_slot[ring->_activeBuffer]._reserved.fetch_add(sizeof(uint64_t));
+
+        const auto startTimePoint = std::chrono::steady_clock::now();
+        std::set<uint64_t> distinct;
+        for (size_t i = 0; i < 2 * SSharedRing::_buffersAmount * bufferSize / sizeof(uint64_t); ++i)
+            distinct.insert(client->GetValue<uint64_t>());
+
+        if (distinct.size() != 2 * SSharedRing::_buffersAmount * bufferSize / sizeof(uint64_t) || std::chrono::steady_clock::now() - startTimePoint > std::chrono::seconds{ 10 })
+            OutputError();
+    }
+
+    {
+        auto client = CRandomSequenceGenerator::MakeSharedClient("randomSequenceGeneratorAbsent", 100'000, DecreaseThreadPriority);
+        WaitForInit(client.get());
+
+        auto r = client->GetValues<std::vector<uint8_t>>(1000);
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestHealthTests()
+{
+    std::cout << "- Test health tests on produced buffers: ";
+
+    std::atomic<size_t> failures = 0;
+    auto gen = CRandomSequenceGenerator::Make(1'000'000, DecreaseThreadPriority, CRandomSequenceGenerator::GPU_IF_POSSIBLE_GENERATOR,
+        [&failures](CRandomSequenceGenerator::EHealthTest) { ++failures; });
+    WaitForInit(gen.get());
+
+    for (size_t i = 0; i < 10; ++i)
+        auto r = gen->GetValues<std::vector<uint8_t>>(gen->BufferSize() / 2);
+
+    if (failures)
+        OutputError();
+
+    // Broken engines are never served : the failed buffer is regenerated, the CPU engine takes over after the repeated failures
+    {
+        static constexpr size_t brokenBufSize = 64 * 1024;
+
+        // Same byte over and over
+        struct SConstantEngine
+        {
+            using result_type = uint64_t;
+            static constexpr result_type min() { return 0; }
+            static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+            void seed(uint64_t) {}
+            result_type operator()() { return 0x5a5a5a5a5a5a5a5aULL; }
+        };
+
+        // Random looking words repeated with the period of the buffer, every buffer is the copy of the first one
+        struct SRepeatingEngine
+        {
+            using result_type = uint64_t;
+            static constexpr result_type min() { return 0; }
+            static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+            void seed(uint64_t) {}
+            result_type operator()()
+            {
+                uint64_t word = (_index++ % (brokenBufSize / sizeof(uint64_t)) + 1) * 0x9e3779b97f4a7c15ULL;
+                word = (word ^ (word >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                word = (word ^ (word >> 27)) * 0x94d049bb133111ebULL;
+                return word ^ (word >> 31);
+            }
+            uint64_t _index = 0;
+        };
+
+        auto checkBrokenEngine = []<typename TEngine>(CRandomSequenceGenerator::EHealthTest expectedTest)
+        {
+            std::mutex failedTestsMutex;
+            std::set<CRandomSequenceGenerator::EHealthTest> failedTests;
+            TRandomSequenceGenerator<TEngine> gen(brokenBufSize, DecreaseThreadPriority, [&](CRandomSequenceGenerator::EHealthTest failedTest)
+            {
+                std::lock_guard lock(failedTestsMutex);
+                failedTests.insert(failedTest);
+            });
+            WaitForInit(&gen);
+
+            std::set<uint64_t> distinct;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                std::vector<uint64_t> values = gen.template GetValues<std::vector<uint64_t>>(brokenBufSize / sizeof(uint64_t));
+                distinct.insert(values.begin(), values.end());
+            }
+
+            std::lock_guard lock(failedTestsMutex);
+            if (!failedTests.contains(expectedTest) || !gen.Statistics()._failedOver || distinct.size() != 4 * brokenBufSize / sizeof(uint64_t))
+                OutputError();
+        };
+
+        checkBrokenEngine.operator()<SConstantEngine>(CRandomSequenceGenerator::REPETITION_COUNT_TEST);
+        checkBrokenEngine.operator()<SRepeatingEngine>(CRandomSequenceGenerator::DUPLICATE_BUFFER_TEST);
+    }
+
+    std::chrono::microseconds generateTimeDelay = std::chrono::duration_cast<std::chrono::microseconds>(gen->Statistics()._generate);
+    std::chrono::microseconds healthTestTimeDelay = std::chrono::duration_cast<std::chrono::microseconds>(gen->Statistics()._healthTest);
+    std::cout << "(" << generateTimeDelay.count() << "us / " << healthTestTimeDelay.count() << "us for generation / health tests) OK" << std::endl;
+}
+
+void TestTemplateGenerator()
+{
+    std::cout << "- Test compile time configured generators: ";
+
+    {
+        TRandomSequenceGenerator<> gen(1'000, DecreaseThreadPriority);
+        WaitForInit(&gen);
+
+        { auto r = gen.GetValue<int>(); }
+        { auto r = gen.GetDataSpan<size_t>(5); }
+        { auto r = gen.GetValues<std::vector<int>>(5); }
+
+        std::vector<uint8_t> first = gen.GetValues<std::vector<uint8_t>>(gen.BufferSize());
+        std::vector<uint8_t> second = gen.GetValues<std::vector<uint8_t>>(gen.BufferSize());
+        if (first == second)
+            OutputError();
+    }
+
+    {
+        struct SCounterEngine
+        {
+            using result_type = uint32_t;
+            static constexpr result_type min() { return 0; }
+            static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+            void seed(uint64_t seed) { _state = static_cast<result_type>(seed); }
+            result_type operator()() { return _state = _state * 1664525U + 1013904223U; }
+            result_type _state = 0;
+        };
+
+        TRandomSequenceGenerator<SCounterEngine, TBuffersPolicy<3>, SSingleConsumerPolicy> gen(1'000, DecreaseThreadPriority);
+        CRandomSequenceGenerator* genInterface = &gen;
+        WaitForInit(genInterface);
+
+        for (size_t i = 0; i < 10; ++i)
+            auto r = genInterface->GetValues<std::vector<uint8_t>>(999);
+
+        try
+        {
+            std::array<uint8_t, 16> bytes;
+            genInterface->GetBytesAsync(bytes, []() {});
+            OutputError();
+        }
+        catch (const std::logic_error&)
+        {
+        }
+    }
+
+    {
+        // Seeded sequence continues from the snapshot like the one of the runtime generator
+        TRandomSequenceGenerator<std::mt19937_64> gen(1'000, DecreaseThreadPriority, nullptr, 42);
+        TRandomSequenceGenerator<std::mt19937_64> sameSeedGen(1'000, DecreaseThreadPriority, nullptr, 42);
+        WaitForInit(&gen);
+        WaitForInit(&sameSeedGen);
+
+        if (gen.GetValues<std::vector<uint8_t>>(700) != sameSeedGen.GetValues<std::vector<uint8_t>>(700))
+            OutputError();
+
+        auto restored = TRandomSequenceGenerator<std::mt19937_64>::Restore(gen.Snapshot(), DecreaseThreadPriority);
+        WaitForInit(restored.get());
+        if (gen.GetValues<std::vector<uint8_t>>(900) != restored->GetValues<std::vector<uint8_t>>(900))
+            OutputError();
+    }
+
+    {
+        // Inline path of the generator type gives the same sequence as the virtual one over the buffer switches
+        auto compareWithVirtualPath = []<typename TGenerator>()
+        {
+            TGenerator gen(1'000, DecreaseThreadPriority, nullptr, 7);
+            TGenerator sameSeedGen(1'000, DecreaseThreadPriority, nullptr, 7);
+            CRandomSequenceGenerator& sameSeedGenInterface = sameSeedGen;
+            WaitForInit(&gen);
+            WaitForInit(&sameSeedGen);
+
+            for (size_t i = 0; i < 1'000; ++i)
+            {
+                if (gen.template GetValue<uint32_t>() != sameSeedGenInterface.GetValue<uint32_t>())
+                    OutputError();
+
+                std::span<uint16_t> values = gen.template GetDataSpan<uint16_t>(i % 50 + 1);
+                std::span<uint16_t> sameSeedValues = sameSeedGenInterface.GetDataSpan<uint16_t>(i % 50 + 1);
+                if (!std::equal(values.begin(), values.end(), sameSeedValues.begin(), sameSeedValues.end()))
+                    OutputError();
+            }
+        };
+
+        compareWithVirtualPath.operator()<TRandomSequenceGenerator<std::mt19937_64>>();
+        compareWithVirtualPath.operator()<TRandomSequenceGenerator<std::mt19937_64, TBuffersPolicy<2>, SSingleConsumerPolicy>>();
+    }
+
+    try
+    {
+        TRandomSequenceGenerator<std::mt19937_64> gen(100, DecreaseThreadPriority);
+        WaitForInit(&gen);
+
+        auto r = gen.GetValues<std::vector<uint8_t>>(101);
+        OutputError();
+    }
+    catch (std::length_error)
+    {
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+struct SDetachedTask
+{
+    struct promise_type
+    {
+        SDetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+SDetachedTask AwaitBytes(CRandomSequenceGenerator* gen, std::vector<uint8_t>* bytes, size_t requestsAmount, std::atomic<size_t>* served)
+{
+    for (size_t i = 0; i < requestsAmount; ++i)
+    {
+        co_await gen->AsyncGetBytes(*bytes);
+        ++*served;
+    }
+}
+
+void TestAsyncRequests()
+{
+    std::cout << "- Test non-blocking and asynchronous requests: ";
+
+    static constexpr size_t bufSize = 1'000;
+    static constexpr size_t requestsAmount = 100;
+    static constexpr size_t requestSize = 300;
+
+    auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+    WaitForInit(gen.get());
+
+    std::vector<uint8_t> bytes(requestSize);
+    size_t tryServed = 0;
+    for (size_t i = 0; i < requestsAmount; ++i)
+        if (gen->TryGetBytes(bytes))
+            ++tryServed;
+    if (tryServed == 0)
+        OutputError();
+    { auto r = gen->TryGetValue<uint32_t>(); }
+
+    try
+    {
+        std::vector<uint8_t> tooManyBytes(bufSize + 1);
+        gen->GetBytesAsync(tooManyBytes, [] {});
+        OutputError();
+    }
+    catch (std::length_error)
+    {
+    }
+
+    std::vector<std::vector<uint8_t>> asyncBytes(requestsAmount, std::vector<uint8_t>(requestSize));
+    std::mutex orderMutex;
+    std::vector<size_t> order;
+    std::atomic<size_t> served = 0;
+    for (size_t i = 0; i < requestsAmount; ++i)
+        gen->GetBytesAsync(asyncBytes[i], [i, &orderMutex, &order, &served]
+        {
+            std::lock_guard lock(orderMutex);
+            order.push_back(i);
+            ++served;
+        });
+
+    std::atomic<size_t> awaited = 0;
+    AwaitBytes(gen.get(), &bytes, requestsAmount, &awaited);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+    while ((served < requestsAmount || awaited < requestsAmount) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+
+    if (served != requestsAmount || awaited != requestsAmount || !std::is_sorted(order.begin(), order.end()))
+        OutputError();
+
+    if (asyncBytes.front() == asyncBytes.back())
+        OutputError();
+
+    {
+        // Buffer is refilled slowly, the queued request waits for it while the rest of the active buffer could serve the awaited one
+        struct SSlowEngine
+        {
+            using result_type = uint64_t;
+            static constexpr result_type min() { return 0; }
+            static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+            void seed(uint64_t seed) { _state = seed; }
+            result_type operator()()
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+                return _state = _state * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+            result_type _state = 0;
+        };
+
+        TRandomSequenceGenerator<SSlowEngine> slowGen(bufSize, DecreaseThreadPriority);
+        WaitForInit(&slowGen);
+        slowGen.GetValues<std::vector<uint8_t>>(bufSize);
+        slowGen.GetValues<std::vector<uint8_t>>(bufSize - requestSize);
+
+        std::vector<uint8_t> queuedBytes(requestSize * 2);
+        std::atomic<bool> queuedServed = false;
+        slowGen.GetBytesAsync(queuedBytes, [&queuedServed] { queuedServed = true; });
+
+        std::vector<uint8_t> awaitedBytes(16);
+        std::atomic<size_t> slowAwaited = 0;
+        AwaitBytes(&slowGen, &awaitedBytes, 1, &slowAwaited);
+        if (slowAwaited != 0 && !queuedServed)
+            OutputError();
+
+        while (slowAwaited == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+    }
+
+    {
+        // Requests lose the consumers lock to the other consumers and are queued while the producer is idle with the ring filled,
+        // the consumers stop before they switch the buffer
+        static constexpr size_t raceBufSize = 64'000'000;
+        static constexpr size_t consumersAmount = 3;
+
+        auto raceGen = CRandomSequenceGenerator::Make(raceBufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+        WaitForInit(raceGen.get());
+        std::this_thread::sleep_for(std::chrono::seconds{ 1 });
+
+        std::atomic<size_t> consumersRunning = consumersAmount;
+        std::vector<std::thread> consumers;
+        for (size_t i = 0; i < consumersAmount; ++i)
+            consumers.emplace_back([&raceGen, &consumersRunning]
+            {
+                for (size_t j = 0; j < raceBufSize / consumersAmount / sizeof(uint64_t) / 2; ++j)
+                    auto r = raceGen->GetValue<uint64_t>();
+                --consumersRunning;
+            });
+
+        std::deque<std::array<uint8_t, sizeof(uint64_t)>> raceBytes;
+        std::atomic<size_t> raceServed = 0;
+        while (consumersRunning)
+        {
+            raceBytes.emplace_back();
+            raceGen->GetBytesAsync(raceBytes.back(), [&raceServed] { ++raceServed; });
+        }
+
+        for (std::thread& consumer : consumers)
+            consumer.join();
+
+        const auto raceDeadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 5 };
+        while (raceServed < raceBytes.size() && std::chrono::steady_clock::now() < raceDeadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+
+        if (raceServed != raceBytes.size())
+            OutputError();
+    }
+
     std::cout << "OK" << std::endl;
+}
+
+// Ring backend filling a buffer only when the test allows it, so the producer progress doesn't depend on the timing
+class CGatedRingGenerator final : public CDoubleBuffersRandomSequenceGenerator
+{
+public:
+    CGatedRingGenerator(size_t memorySizeInBytes, const SBuffering& buffering) :
+        CDoubleBuffersRandomSequenceGenerator(memorySizeInBytes, DecreaseThreadPriority, nullptr, buffering, std::nullopt)
+    {
+        InitBase();
+    }
+
+    ~CGatedRingGenerator() noexcept override
+    {
+        {
+            std::lock_guard lock(_fillsMutex);
+            _closing = true;
+        }
+        _fillsCondVar.notify_all();
+        StopThread();
+    }
+
+    void AllowFills(size_t fills)
+    {
+        {
+            std::lock_guard lock(_fillsMutex);
+            _permits += fills;
+        }
+        _fillsCondVar.notify_all();
+    }
+
+    // Buffer is published after its fill, the statistics carry the number of the fill then. Permits left after the timeout are taken back
+    bool WaitForFills(size_t fills, std::chrono::milliseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        {
+            std::unique_lock lock(_fillsMutex);
+            const bool filled = _fillsCondVar.wait_until(lock, deadline, [this, fills] { return _fills >= fills; });
+            _permits = 0;
+            if (!filled)
+                return false;
+        }
+
+        while (static_cast<size_t>(Statistics()._generate.count()) < fills)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::yield();
+        }
+
+        return true;
+    }
+
+private:
+    std::vector<TBuffer> _buffers;
+    CMtXorLceEngine _engine;
+    std::mutex _fillsMutex;
+    std::condition_variable _fillsCondVar;
+    size_t _permits = 0;
+    size_t _fills = 0;
+    bool _closing = false;
+
+    void AllocBuffers(size_t buffers, size_t bytesInBuffer) override
+    {
+        _buffers.resize(buffers);
+        for (TBuffer& buffer : _buffers)
+            buffer.resize(bytesInBuffer);
+    }
+
+    bool ImplInit() override { return true; }
+    size_t ChunkSize() const noexcept override { return BufferSize(); }
+    TByte* Array(size_t bufferNum) noexcept override { return _buffers[bufferNum].data(); }
+    TBuffer EngineState() const override { return TBuffer(); }
+    EGeneratorType GeneratorType() const noexcept override { return CPU_GENERATOR; }
+
+    bool FillBuffer(size_t bufferNum, size_t offset, size_t size) override
+    {
+        std::unique_lock lock(_fillsMutex);
+        _fillsCondVar.wait(lock, [this] { return _permits > 0 || _closing; });
+        if (!_closing)
+            --_permits;
+
+        FillRandomBytes(_engine, _buffers[bufferNum].data() + offset, size);
+        ++_fills;
+
+        SStatistics stat{};
+        stat._generate = SStatistics::TTimeMeasurement{ _fills };
+        SetStatistics(stat);
+
+        _fillsCondVar.notify_all();
+        return true;
+    }
+};
+
+// Consumer gets over the low-water mark of the second buffer while the first one is being refilled and then goes through
+// the next two buffers. Returns the requests the consumer would have to wait for
+static size_t LowWaterMarkWaits(double lowWaterMark)
+{
+    static constexpr size_t bufSize = 4'096;
+    static constexpr std::chrono::seconds fillTimeout{ 10 };
+
+    CGatedRingGenerator gen(bufSize, { 2, 3, lowWaterMark });
+    gen.AllowFills(2);
+    WaitForInit(&gen);
+    if (!gen.WaitForFills(2, fillTimeout))
+        OutputError();
+
+    // Request reaching the end of the buffer is served from the next one, the sixth request gets over the mark of the second buffer
+    std::vector<uint8_t> bytes(bufSize / 4);
+    for (size_t i = 0; i < 6; ++i)
+        auto r = gen.GetDataSpan<uint8_t>(bytes.size());
+
+    gen.AllowFills(1);
+    if (!gen.WaitForFills(3, fillTimeout))
+        OutputError();
+
+    // Only the buffer added at the mark has something to fill
+    gen.AllowFills(1);
+    gen.WaitForFills(4, std::chrono::milliseconds{ 200 });
+
+    size_t waits = 0;
+    for (size_t i = 0; i < 4; ++i)
+        if (!gen.TryGetBytes(bytes))
+            ++waits;
+
+    return waits;
+}
+
+void TestAdaptiveBuffering()
+{
+    std::cout << "- Test adaptive ring of buffers: ";
+
+    static constexpr size_t bufSize = 1'000'000;
+    const CRandomSequenceGenerator::SBuffering buffering{ 2, 6, 0.25 };
+
+    auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR, nullptr, buffering);
+    WaitForInit(gen.get());
+
+    // Bursts of three buffers can't be served by the double buffering without waiting
+    for (size_t burst = 0; burst < 20; ++burst)
+    {
+        for (size_t i = 0; i < 3 * 4; ++i)
+            auto r = gen->GetDataSpan<uint8_t>(bufSize / 4);
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+    }
+
+    const CRandomSequenceGenerator::SStatistics stat = gen->Statistics();
+    if (stat._buffers <= buffering._minBuffers || stat._buffers > buffering._maxBuffers || stat._consumptionRate <= 0)
+        OutputError();
+
+    try
+    {
+        auto wrongGen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR, nullptr, { 3, 2, 0.0 });
+        OutputError();
+    }
+    catch (std::out_of_range)
+    {
+    }
+
+    if (LowWaterMarkWaits(0.5) != 0 || LowWaterMarkWaits(0.0) == 0)
+        OutputError();
+
+    std::cout << stat._buffers << " buffers OK" << std::endl;
+}
+
+void TestChaChaGenerator()
+{
+    std::cout << "- Test ChaCha generators: ";
+
+    static constexpr size_t bufSize = 1'000'003;
+
+    for (CRandomSequenceGenerator::EGeneratorType genType : { CRandomSequenceGenerator::CHACHA8_GENERATOR, CRandomSequenceGenerator::CHACHA12_GENERATOR, CRandomSequenceGenerator::CHACHA20_GENERATOR })
+    {
+        auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType);
+        WaitForInit(gen.get());
+
+        std::vector<uint64_t> first = gen->GetValues<std::vector<uint64_t>>(bufSize / sizeof(uint64_t));
+        std::vector<uint64_t> second = gen->GetValues<std::vector<uint64_t>>(bufSize / sizeof(uint64_t));
+        if (first == second)
+            OutputError();
+
+        std::sort(first.begin(), first.end());
+        if (std::adjacent_find(first.begin(), first.end()) != first.end())
+            OutputError();
 
-}
\ No newline at end of file
+        auto otherGen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType);
+        WaitForInit(otherGen.get());
+        if (gen->GetValue<uint64_t>() == otherGen->GetValue<uint64_t>())
+            OutputError();
+    }
+
+    // RFC 8439 2.3.2 block : its 32-bit counter and the first nonce word make the 64-bit counter of the original layout
+    std::array<uint32_t, 16> state = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c, 0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c,
+        0, 0, 0x4a000000, 0x00000000 };
+    const uint64_t counter = 0x0900000000000001;
+    const std::array<uint8_t, 64> expectedBlock = {
+        0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+        0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+        0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+        0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e };
+
+    for (CChaChaEngine::EKernel kernel : CChaChaEngine::SupportedKernels())
+    {
+        std::array<uint8_t, 64> block;
+        CChaChaEngine::KernelBlocks(kernel, state.data(), counter, 20, block.data(), 1);
+        if (block != expectedBlock)
+            OutputError();
+    }
+
+    // Wide kernels match the scalar one for every blocks amount, the counter carries into its high word within the run
+    static constexpr size_t maxBlocks = 100;
+    std::mt19937 stateGen(20'251'019);
+    for (size_t i = 4; i < state.size(); ++i)
+        state[i] = stateGen();
+    const uint64_t carryCounter = 0xffffffff - maxBlocks / 2;
+
+    for (size_t rounds : { 8, 12, 20 })
+    {
+        for (size_t blocks = 1; blocks <= maxBlocks; ++blocks)
+        {
+            std::vector<uint8_t> scalar(blocks * 64);
+            CChaChaEngine::KernelBlocks(CChaChaEngine::SCALAR_KERNEL, state.data(), carryCounter, rounds, scalar.data(), blocks);
+
+            for (CChaChaEngine::EKernel kernel : CChaChaEngine::SupportedKernels())
+            {
+                std::vector<uint8_t> wide(blocks * 64);
+                CChaChaEngine::KernelBlocks(kernel, state.data(), carryCounter, rounds, wide.data(), blocks);
+                if (wide != scalar)
+                    OutputError();
+            }
+
+            std::vector<uint8_t> dispatched(blocks * 64);
+            CChaChaEngine::KeystreamBlocks(state.data(), carryCounter, rounds, dispatched.data(), blocks);
+            if (dispatched != scalar)
+                OutputError();
+        }
+    }
+
+    std::cout << CChaChaEngine::SupportedKernels().size() << " kernels OK" << std::endl;
+}
+
+void TestShuffleAndSampling()
+{
+    std::cout << "- Test shuffle and sampling: ";
+
+    static constexpr size_t bufSize = 1'000'000;
+
+    auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+    WaitForInit(gen.get());
+
+    std::vector<uint32_t> values(1'000'000);
+    std::iota(values.begin(), values.end(), 0);
+    std::vector<uint32_t> shuffled = values;
+    Shuffle(*gen, std::span(shuffled));
+    if (shuffled == values)
+        OutputError();
+    std::sort(shuffled.begin(), shuffled.end());
+    if (shuffled != values)
+        OutputError();
+
+    shuffled = values;
+    ParallelShuffle(*gen, std::span(shuffled), 4);
+    if (shuffled == values)
+        OutputError();
+    std::sort(shuffled.begin(), shuffled.end());
+    if (shuffled != values)
+        OutputError();
+
+    {
+        // Generator without the consumers lock is requested from the calling thread only, as by the serial shuffle
+        TRandomSequenceGenerator<std::mt19937_64, TBuffersPolicy<2>, SSingleConsumerPolicy> singleConsumerGen(bufSize, DecreaseThreadPriority, nullptr, 11);
+        TRandomSequenceGenerator<std::mt19937_64, TBuffersPolicy<2>, SSingleConsumerPolicy> sameSeedGen(bufSize, DecreaseThreadPriority, nullptr, 11);
+        WaitForInit(&singleConsumerGen);
+        WaitForInit(&sameSeedGen);
+        if (singleConsumerGen.ConcurrentConsumers() || !gen->ConcurrentConsumers())
+            OutputError();
+
+        shuffled = values;
+        std::vector<uint32_t> serialShuffled = values;
+        ParallelShuffle(singleConsumerGen, std::span(shuffled), 4);
+        Shuffle(sameSeedGen, std::span(serialShuffled));
+        if (shuffled != serialShuffled || shuffled == values)
+            OutputError();
+    }
+
+    // Every permutation of four elements is equally likely, several draws share the word for such small sizes
+    std::map<std::array<int, 4>, size_t> permutations;
+    for (size_t i = 0; i < 24'000; ++i)
+    {
+        std::array<int, 4> permutation = { 0, 1, 2, 3 };
+        Shuffle(*gen, std::span<int>(permutation));
+        ++permutations[permutation];
+    }
+    if (permutations.size() != 24)
+        OutputError();
+    for (const auto& [permutation, count] : permutations)
+        if (count < 800 || count > 1200)
+            OutputError();
+
+    std::list<uint32_t> stream(values.begin(), values.begin() + 10'000);
+    std::vector<uint32_t> reservoir(100);
+    if (ReservoirSample(*gen, stream.begin(), stream.end(), std::span(reservoir)) != reservoir.size())
+        OutputError();
+    std::sort(reservoir.begin(), reservoir.end());
+    if (std::adjacent_find(reservoir.begin(), reservoir.end()) != reservoir.end() || reservoir.back() >= stream.size())
+        OutputError();
+    if (ReservoirSample(*gen, stream.begin(), std::next(stream.begin(), 5), std::span(reservoir)) != 5)
+        OutputError();
+
+    std::vector<uint64_t> sample = SampleIndexes(*gen, 1'000'000, 1'000);
+    std::sort(sample.begin(), sample.end());
+    if (sample.size() != 1'000 || std::adjacent_find(sample.begin(), sample.end()) != sample.end() || sample.back() >= 1'000'000)
+        OutputError();
+
+    sample = SampleIndexes(*gen, 100, 100);
+    std::sort(sample.begin(), sample.end());
+    for (uint64_t i = 0; i < sample.size(); ++i)
+        if (sample[i] != i)
+            OutputError();
+
+    try
+    {
+        SampleIndexes(*gen, 10, 11);
+        OutputError();
+    }
+    catch (std::out_of_range)
+    {
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestBits()
+{
+    std::cout << "- Test bits: ";
+
+    static constexpr size_t bufSize = 1'000'000;
+
+    auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+    WaitForInit(gen.get());
+
+    // Requests of different widths are served from the same cursor word and across the word borders
+    size_t ones = 0;
+    for (size_t i = 0; i < 100'000; ++i)
+    {
+        const size_t bitsAmount = i % 65;
+        const uint64_t bits = gen->GetBits(bitsAmount);
+        if (bitsAmount < 64 && bits >> bitsAmount != 0)
+            OutputError();
+        ones += std::popcount(bits);
+    }
+    if (ones < 1'550'000 || ones > 1'650'000)
+        OutputError();
+
+    try
+    {
+        gen->GetBits(65);
+        OutputError();
+    }
+    catch (std::out_of_range)
+    {
+    }
+
+    std::vector<bool> flags(100'001);
+    gen->FillBits(flags);
+    const size_t flagsSet = std::count(flags.begin(), flags.end(), true);
+    if (flagsSet < 49'000 || flagsSet > 51'000)
+        OutputError();
+
+    std::bitset<1000> bitset;
+    gen->FillBits(bitset);
+    if (bitset.count() < 400 || bitset.count() > 600)
+        OutputError();
+
+    {
+        // Bits are the lowest bits of the words first, the bits set before are cleared
+        TRandomSequenceGenerator<std::mt19937_64> bitsGen(1'000, DecreaseThreadPriority, nullptr, 5);
+        TRandomSequenceGenerator<std::mt19937_64> sameSeedGen(1'000, DecreaseThreadPriority, nullptr, 5);
+        WaitForInit(&bitsGen);
+        WaitForInit(&sameSeedGen);
+
+        std::vector<bool> seededFlags(130, true);
+        std::bitset<200> seededBitset;
+        seededBitset.set();
+        std::bitset<40> shortBitset;
+        bitsGen.FillBits(seededFlags);
+        bitsGen.FillBits(seededBitset);
+        bitsGen.FillBits(shortBitset);
+
+        auto sameBits = [&sameSeedGen](const auto& bits, size_t bitsAmount)
+        {
+            bool same = true;
+            for (size_t bit = 0; bit < bitsAmount; bit += 64)
+            {
+                const uint64_t word = sameSeedGen.GetValue<uint64_t>();
+                for (size_t wordBit = 0; wordBit < 64 && bit + wordBit < bitsAmount; ++wordBit)
+                    same = same && bits[bit + wordBit] == ((word >> wordBit & 1) != 0);
+            }
+            return same;
+        };
+
+        if (!sameBits(seededFlags, seededFlags.size()) || !sameBits(seededBitset, seededBitset.size()) || !sameBits(shortBitset, shortBitset.size()))
+            OutputError();
+    }
+
+    std::vector<uint64_t> mask(100'000);
+    gen->GetBernoulliMask(mask, 0.3);
+    size_t maskSet = 0;
+    for (uint64_t word : mask)
+        maskSet += std::popcount(word);
+    const double frequency = static_cast<double>(maskSet) / (mask.size() * 64);
+    if (frequency < 0.298 || frequency > 0.302)
+        OutputError();
+
+    gen->GetBernoulliMask(mask, 0.0);
+    if (std::any_of(mask.begin(), mask.end(), [](uint64_t word) { return word != 0; }))
+        OutputError();
+
+    gen->GetBernoulliMask(mask, 1.0);
+    if (std::any_of(mask.begin(), mask.end(), [](uint64_t word) { return word != ~uint64_t{ 0 }; }))
+        OutputError();
+
+    try
+    {
+        gen->GetBernoulliMask(mask, 1.5);
+        OutputError();
+    }
+    catch (std::out_of_range)
+    {
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestAliasSampler()
+{
+    std::cout << "- Test alias sampler: ";
+
+    static constexpr size_t bufSize = 1'000'000;
+
+    auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+    WaitForInit(gen.get());
+
+    const std::vector<double> weights = { 1.0, 0.0, 2.0, 3.0, 4.0 };
+    CAliasSampler sampler(weights);
+    if (sampler.Size() != weights.size())
+        OutputError();
+
+    // Batch spans several buffers
+    std::vector<uint32_t> indexes(1'000'000);
+    sampler.Sample(*gen, indexes);
+
+    std::vector<size_t> counts(weights.size(), 0);
+    for (uint32_t index : indexes)
+        ++counts.at(index);
+
+    if (counts[1] != 0)
+        OutputError();
+    for (size_t i = 0; i < weights.size(); ++i)
+        if (std::abs(static_cast<double>(counts[i]) / indexes.size() - weights[i] / 10.0) > 0.003)
+            OutputError();
+
+    if (sampler.Sample(*gen) == 1)
+        OutputError();
+
+    for (const std::vector<double>& wrongWeights : { std::vector<double>{}, std::vector<double>{ 0.0, 0.0 }, std::vector<double>{ 1.0, -1.0 } })
+    {
+        try
+        {
+            CAliasSampler wrongSampler(wrongWeights);
+            OutputError();
+        }
+        catch (std::length_error)
+        {
+        }
+        catch (std::out_of_range)
+        {
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestSeededGenerator()
+{
+    std::cout << "- Test seeded generators and snapshots: ";
+
+    static constexpr size_t bufSize = 100'003;
+    static constexpr size_t valuesAmount = 1'000;
+    static constexpr uint64_t seed = 42;
+
+    for (CRandomSequenceGenerator::EGeneratorType genType : { CRandomSequenceGenerator::CPU_GENERATOR, CRandomSequenceGenerator::CHACHA8_GENERATOR })
+    {
+        auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType, nullptr, {}, seed);
+        auto sameGen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType, nullptr, {}, seed);
+        auto otherGen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType, nullptr, {}, seed + 1);
+
+        // Requests go through several buffers, the tails of the buffers are skipped
+        for (size_t i = 0; i < 50; ++i)
+        {
+            std::vector<uint64_t> values = gen->GetValues<std::vector<uint64_t>>(valuesAmount);
+            if (values != sameGen->GetValues<std::vector<uint64_t>>(valuesAmount) || values == otherGen->GetValues<std::vector<uint64_t>>(valuesAmount))
+                OutputError();
+        }
+
+        const CRandomSequenceGenerator::TSnapshot snapshot = gen->Snapshot();
+        std::vector<std::vector<uint64_t>> expected;
+        for (size_t i = 0; i < 50; ++i)
+            expected.push_back(gen->GetValues<std::vector<uint64_t>>(valuesAmount));
+
+        auto restoredGen = CRandomSequenceGenerator::Restore(snapshot, DecreaseThreadPriority);
+        for (size_t i = 0; i < 50; ++i)
+            if (restoredGen->GetValues<std::vector<uint64_t>>(valuesAmount) != expected[i])
+                OutputError();
+    }
+
+    try
+    {
+        auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+        gen->Snapshot();
+        OutputError();
+    }
+    catch (std::runtime_error)
+    {
+    }
+
+    try
+    {
+        auto gen = CRandomSequenceGenerator::Restore(CRandomSequenceGenerator::TSnapshot(10, 0), DecreaseThreadPriority);
+        OutputError();
+    }
+    catch (std::runtime_error)
+    {
+    }
+
+    CRandomSequenceGenerator::SeedBytesOnce(seed);
+    const CRandomSequenceGenerator::TBuffer bytes = CRandomSequenceGenerator::GetBytesOnce(1'000);
+    CRandomSequenceGenerator::SeedBytesOnce(seed);
+    if (bytes != CRandomSequenceGenerator::GetBytesOnce(1'000))
+        OutputError();
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestProgressivePublishing()
+{
+    std::cout << "- Test progressive publishing of the buffers: ";
+
+    static constexpr size_t bufSize = 32 * 1024 * 1024 + 3;
+    static constexpr size_t valuesAmount = 4'096;
+    static constexpr uint64_t seed = 42;
+
+    for (CRandomSequenceGenerator::EGeneratorType genType : { CRandomSequenceGenerator::CPU_GENERATOR, CRandomSequenceGenerator::CHACHA8_GENERATOR })
+    {
+        auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType, nullptr, {}, seed);
+
+        // First bytes are served long before the whole buffer is filled
+        const auto startTimePoint = std::chrono::steady_clock::now();
+        if (!gen->WaitUntilReady(std::chrono::seconds{ 10 }))
+            OutputError();
+        gen->GetValue<uint64_t>();
+        const auto firstValueDuration = std::chrono::steady_clock::now() - startTimePoint;
+
+        // Bytes read while the buffer is being filled are the same as the bytes read from the filled buffer
+        auto filledGen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType, nullptr, {}, seed);
+        filledGen->GetValue<uint64_t>();
+        while (filledGen->Statistics()._bufSize == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+
+        for (size_t i = 0; i < 3 * bufSize / 2 / sizeof(uint64_t) / valuesAmount; ++i)
+            if (gen->GetValues<std::vector<uint64_t>>(valuesAmount) != filledGen->GetValues<std::vector<uint64_t>>(valuesAmount))
+                OutputError();
+
+        if (firstValueDuration >= gen->Statistics()._generate)
+            OutputError();
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestGpuWarmUp()
+{
+    std::cout << "- Test requests served during the GPU warm-up: ";
+
+    static constexpr size_t bufSize = 1'000'000;
+    static constexpr size_t threadsAmount = 4;
+    static constexpr size_t valuesAmount = 1'000;
+
+    // CPU generator serves the first request while the GPU generator initializes
+    const auto startTimePoint = std::chrono::steady_clock::now();
+    auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::GPU_IF_POSSIBLE_GENERATOR);
+    { auto r = gen->GetValue<uint64_t>(); }
+    const auto firstValueDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTimePoint);
+
+    // Requests of several threads go through the handover
+    std::vector<std::thread> threads;
+    std::atomic<size_t> repeated = 0;
+    for (size_t thread = 0; thread < threadsAmount; ++thread)
+        threads.emplace_back([&gen, &repeated]()
+        {
+            for (size_t i = 0; i < 100; ++i)
+            {
+                std::vector<uint64_t> values = gen->GetValues<std::vector<uint64_t>>(valuesAmount);
+                if (std::adjacent_find(values.begin(), values.end()) != values.end())
+                    ++repeated;
+            }
+        });
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    if (repeated)
+        OutputError();
+
+    std::vector<uint8_t> bytes(bufSize / 2);
+    std::atomic<bool> served = false;
+    gen->GetBytesAsync(bytes, [&served] { served = true; });
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+    while (!served && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+
+    if (!served)
+        OutputError();
+
+    std::cout << "(" << firstValueDuration.count() << "us to the first value) OK" << std::endl;
+}
+
+void TestKernelConfigCache()
+{
+    std::cout << "- Test the cache of the tuned GPU kernels: ";
+
+    using SKernelConfig = CKernelConfigCache::SKernelConfig;
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "randomSequenceGeneratorKernels.txt";
+    std::filesystem::remove(path);
+    const CKernelConfigCache cache(path);
+
+    if (cache.Load("device A"))
+        OutputError();
+
+    // Entries of the devices are stored and replaced independently
+    const SKernelConfig configA{ 64, 16, 4 };
+    const SKernelConfig configB{ 0, 1, 1 };
+    const SKernelConfig replacedA{ 1024, 64, 8 };
+    cache.Store("device A", configA);
+    cache.Store("device B", configB);
+    if (cache.Load("device A") != configA || cache.Load("device B") != configB)
+        OutputError();
+
+    cache.Store("device A", replacedA);
+    if (cache.Load("device A") != replacedA || cache.Load("device B") != configB || cache.Load("device"))
+        OutputError();
+
+    // Only the renamed file is left behind
+    size_t files = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(path.parent_path()))
+        files += entry.path().filename().string().starts_with(path.filename().string());
+    if (files != 1)
+        OutputError();
+
+    // Values out of the tuned ones and the broken lines are skipped, the valid line of the device is found after them
+    {
+        std::ofstream file(path, std::ios::app);
+        file << "device C\t2048 4 8\n" << "device C\t64 3 8\n" << "device C\t64 4 3\n" << "device C\t64 4\n" << "device C\t64 4 8 1\n" << "device C\t-64 4 8\n";
+    }
+    if (cache.Load("device C"))
+        OutputError();
+
+    {
+        std::ofstream file(path, std::ios::app);
+        file << "device C\t512 4 2\n";
+    }
+    if (cache.Load("device C") != SKernelConfig{ 512, 4, 2 } || cache.Load("device A") != replacedA)
+        OutputError();
+
+    std::filesystem::remove(path);
+
+    // Empty path disables the cache
+    const CKernelConfigCache disabledCache({});
+    disabledCache.Store("device A", configA);
+    if (disabledCache.Load("device A"))
+        OutputError();
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestContainerReuse()
+{
+    std::cout << "- Test containers with the allocators and the reused memory: ";
+
+    static constexpr size_t valuesAmount = 100;
+
+    auto gen = CRandomSequenceGenerator::Make(1'000, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR);
+    WaitForInit(gen.get());
+
+    // Arena without the upstream resource throws on the allocation it can't serve
+    std::array<std::byte, 64 * 1024> arena;
+    std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(), std::pmr::null_memory_resource());
+    try
+    {
+        for (size_t i = 0; i < 10; ++i)
+        {
+            std::pmr::vector<uint32_t> values = gen->GetValues<std::pmr::vector<uint32_t>>(valuesAmount, &resource);
+            std::pmr::string chars = gen->GetValues<std::pmr::string>(valuesAmount, &resource);
+            std::pmr::deque<uint16_t> deque = gen->GetValues<std::pmr::deque<uint16_t>>(valuesAmount, &resource);
+            if (values.size() != valuesAmount || chars.size() != valuesAmount || deque.size() != valuesAmount || values.get_allocator().resource() != &resource)
+                OutputError();
+        }
+    }
+    catch (std::bad_alloc)
+    {
+        OutputError();
+    }
+
+    std::vector<uint64_t> values;
+    values.reserve(valuesAmount);
+    const uint64_t* data = values.data();
+    for (size_t i = 0; i < 10; ++i)
+    {
+        gen->AssignValues(values, valuesAmount);
+        if (values.size() != valuesAmount || values.data() != data)
+            OutputError();
+    }
+
+    std::string chars;
+    gen->AppendValues(chars, valuesAmount);
+    const std::string prefix = chars;
+    gen->AppendValues(chars, valuesAmount);
+    if (chars.size() != 2 * valuesAmount || chars.compare(0, valuesAmount, prefix) != 0)
+        OutputError();
+
+    std::list<int> list(3);
+    gen->AssignValues(list, valuesAmount);
+    if (list.size() != valuesAmount)
+        OutputError();
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestTokens()
+{
+    std::cout << "- Test tokens and UUIDs: ";
+
+    static constexpr size_t bufSize = 100'000;
+    static constexpr uint64_t seed = 42;
+
+    // Power of two alphabet takes a byte per character, the seeded twin gives the bytes to compare with
+    auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR, nullptr, {}, seed);
+    auto twin = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, CRandomSequenceGenerator::CPU_GENERATOR, nullptr, {}, seed);
+    WaitForInit(gen.get());
+    WaitForInit(twin.get());
+
+    CTokenArena hexTokens = GetHexTokens(*gen, 1'000, 33);
+    std::vector<uint8_t> bytes = twin->GetValues<std::vector<uint8_t>>(hexTokens.Characters().size());
+    if (hexTokens.Size() != 1'000 || hexTokens[999].size() != 33)
+        OutputError();
+    for (size_t i = 0; i < bytes.size(); ++i)
+        if (hexTokens.Characters()[i] != hexAlphabet[bytes[i] & 0x0f])
+            OutputError();
+
+    CTokenArena uuids = GetUuids(*gen, 1'000);
+    bytes = twin->GetValues<std::vector<uint8_t>>(16 * uuids.Size());
+    for (size_t uuid = 0; uuid < uuids.Size(); ++uuid)
+    {
+        std::string expected;
+        for (size_t byte = 0; byte < 16; ++byte)
+        {
+            uint8_t value = bytes[16 * uuid + byte];
+            value = byte == 6 ? (value & 0x0f) | 0x40 : byte == 8 ? (value & 0x3f) | 0x80 : value;
+            expected += hexAlphabet[value >> 4];
+            expected += hexAlphabet[value & 0x0f];
+            if (byte == 3 || byte == 5 || byte == 7 || byte == 9)
+                expected += '-';
+        }
+
+        if (uuids[uuid] != expected || uuids[uuid][14] != '4' || std::string_view("89ab").find(uuids[uuid][19]) == std::string_view::npos)
+            OutputError();
+    }
+
+    // Rejected bytes leave the characters uniform, the wide alphabet is encoded by the scalar loop
+    std::string wideAlphabet;
+    for (size_t i = 0; i < 200; ++i)
+        wideAlphabet += static_cast<char>(i);
+
+    for (std::string_view alphabet : { alphanumericAlphabet, base64UrlAlphabet, std::string_view("abc"), std::string_view(wideAlphabet) })
+    {
+        CTokenArena tokens = GetTokens(*gen, 10'000, 50, alphabet);
+        std::vector<size_t> counts(256, 0);
+        for (char character : tokens.Characters())
+            ++counts[static_cast<uint8_t>(character)];
+
+        const double expected = static_cast<double>(tokens.Characters().size()) / alphabet.size();
+        size_t inAlphabet = 0;
+        for (char character : alphabet)
+        {
+            inAlphabet += counts[static_cast<uint8_t>(character)];
+            if (std::abs(counts[static_cast<uint8_t>(character)] - expected) > 6 * std::sqrt(expected))
+                OutputError();
+        }
+
+        if (inAlphabet != tokens.Characters().size())
+            OutputError();
+    }
+
+    const std::string tooWideAlphabet(257, 'a');
+    for (std::string_view alphabet : { std::string_view(), std::string_view(tooWideAlphabet) })
+    {
+        try
+        {
+            GetTokens(*gen, 1, 1, alphabet);
+            OutputError();
+        }
+        catch (std::length_error)
+        {
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+void TestGeneratorShutdown()
+{
+    std::cout << "- Test destruction while the producer is filling the buffers: ";
+
+    static constexpr size_t bufSize = 4'000'000;
+
+    // Producer is stopped in the middle of the fill, the consumer has taken the part of the ring or nothing
+    for (CRandomSequenceGenerator::EGeneratorType genType : { CRandomSequenceGenerator::CPU_GENERATOR, CRandomSequenceGenerator::CHACHA8_GENERATOR, CRandomSequenceGenerator::GPU_IF_POSSIBLE_GENERATOR })
+    {
+        for (size_t i = 0; i < 20; ++i)
+        {
+            auto gen = CRandomSequenceGenerator::Make(bufSize, DecreaseThreadPriority, genType);
+            if (i % 2 == 0)
+                continue;
+
+            gen->GetValues<std::vector<uint8_t>>(gen->BufferSize() / 2);
+            if (gen->Statistics()._failedOver)
+                OutputError();
+        }
+    }
+
+    std::cout << "OK" << std::endl;
+}
+
+// Backend fills the first buffers and then fails, the failure comes after the delay so the consumer is already waiting for it
+class CFailingRingGenerator final : public CDoubleBuffersRandomSequenceGenerator
+{
+public:
+    CFailingRingGenerator(size_t memorySizeInBytes, size_t goodFills, bool failoverAllowed) :
+        CDoubleBuffersRandomSequenceGenerator(memorySizeInBytes, DecreaseThreadPriority, nullptr, {}, SStreamPosition{ 1, {}, 0 }),
+        _goodFills(goodFills),
+        _failoverAllowed(failoverAllowed)
+    {
+        InitBase();
+    }
+
+    ~CFailingRingGenerator() noexcept override
+    {
+        StopThread();
+    }
+
+private:
+    static constexpr std::chrono::milliseconds _failureDelay{ 100 };
+
+    std::vector<TBuffer> _buffers;
+    CMtXorLceEngine _engine;
+    const size_t _goodFills;
+    const bool _failoverAllowed;
+    size_t _fills = 0;
+
+    void AllocBuffers(size_t buffers, size_t bytesInBuffer) override
+    {
+        _buffers.resize(buffers);
+        for (TBuffer& buffer : _buffers)
+            buffer.resize(bytesInBuffer);
+    }
+
+    bool ImplInit() override { return true; }
+    bool FailoverAllowed() const noexcept override { return _failoverAllowed; }
+    TByte* Array(size_t bufferNum) noexcept override { return _buffers[bufferNum].data(); }
+    TBuffer EngineState() const override { return TBuffer(); }
+    EGeneratorType GeneratorType() const noexcept override { return CPU_GENERATOR; }
+
+    bool FillBuffer(size_t bufferNum, size_t offset, size_t size) override
+    {
+        if (_fills == _goodFills)
+        {
+            std::this_thread::sleep_for(_failureDelay);
+            throw std::runtime_error("Device has been lost");
+        }
+
+        FillRandomBytes(_engine, _buffers[bufferNum].data() + offset, size);
+        if (offset + size == BufferSize())
+            ++_fills;
+
+        return true;
+    }
+};
+
+void TestProducerFailover()
+{
+    std::cout << "- Test the failover of the failed producer: ";
+
+    static constexpr size_t bufSize = 256 * 1024;
+
+    // Consumer waiting for the failed fill gets the bytes of the CPU engine, the sequence isn't reproducible any more
+    {
+        CFailingRingGenerator gen(bufSize, 1, true);
+        WaitForInit(&gen);
+
+        for (size_t i = 0; i < 16; ++i)
+        {
+            std::vector<uint8_t> bytes = gen.GetValues<std::vector<uint8_t>>(bufSize / 2);
+            if (static_cast<size_t>(std::count(bytes.begin(), bytes.end(), 0)) > bytes.size() / 128)
+                OutputError();
+        }
+
+        const CRandomSequenceGenerator::SStatistics stat = gen.Statistics();
+        if (!stat._failedOver || stat._failoverLatency.count() <= 0)
+            OutputError();
+
+        bool snapshotRefused = false;
+        try
+        {
+            gen.Snapshot();
+        }
+        catch (const std::runtime_error&)
+        {
+            snapshotRefused = true;
+        }
+        if (!snapshotRefused)
+            OutputError();
+    }
+
+    // Backend opted out of the failover as the ChaCha one, the waiting consumer throws instead of getting the weaker bytes
+    {
+        CFailingRingGenerator gen(bufSize, 0, false);
+
+        bool failed = false;
+        try
+        {
+            gen.GetValue<uint64_t>();
+        }
+        catch (const std::runtime_error&)
+        {
+            failed = true;
+        }
+        if (!failed || gen.Statistics()._failedOver)
+            OutputError();
+
+        failed = false;
+        try
+        {
+            gen.WaitUntilReady(std::chrono::milliseconds{ 0 });
+        }
+        catch (const std::runtime_error&)
+        {
+            failed = true;
+        }
+        if (!failed)
+            OutputError();
+    }
+
+    std::cout << "OK" << std::endl;
+}